@@ -0,0 +1,428 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Linq;
+using System.Text;
+using System.Drawing;
+using System.IO;
+using System.Runtime.InteropServices;
+using System.Threading;
+
+namespace ZwcBookMaker
+{
+    /// <summary>
+    /// Copies a PDF from slow storage into a local file in the background and
+    /// lets the SDK open it while the copy is still running. Ranges the SDK asks
+    /// for through FX_DOWNLOADHINTS are copied before the rest of the file, so a
+    /// linearized PDF can render its first pages long before the tail arrives.
+    /// </summary>
+    public class ArrivingPDFSource : IDisposable
+    {
+        const int chunkSize = 64 * 1024;
+
+        string localPath;
+        long fileLength;
+        FileStream sourceStream;
+        FileStream localWriter;
+        FileStream localReader;
+
+        object chunkLock = new object();
+        bool[] chunkAvailable;
+        int availableChunkCount = 0;
+        int nextSequentialChunk = 0;
+        Queue<int> priorityChunks = new Queue<int>();
+        Thread copyThread;
+        bool stopCopying = false;
+        Exception copyError = null;
+
+        // Keep the callbacks alive, the SDK only holds the function pointers.
+        FPDF_GetBlock getBlock;
+        FX_IsDataAvail isDataAvail;
+        FX_AddSegment addSegment;
+        IntPtr fileAccess;
+        IntPtr fileAvail;
+        IntPtr hints;
+        IntPtr avail = IntPtr.Zero;
+
+        FoxitPDFReader reader = null;
+
+        int prioritizedChunkCount = 0;
+        int waitCount = 0;
+        DateTime startTime = DateTime.Now;
+        TimeSpan firstPageTime = TimeSpan.Zero;
+
+        public ArrivingPDFSource(string sourcePath, string localPath)
+        {
+            this.localPath = localPath;
+
+            sourceStream = File.Open(sourcePath, FileMode.Open, FileAccess.Read, FileShare.ReadWrite);
+            fileLength = sourceStream.Length;
+
+            localWriter = new FileStream(localPath, FileMode.Create, FileAccess.Write, FileShare.ReadWrite);
+            localWriter.SetLength(fileLength);
+            localReader = new FileStream(localPath, FileMode.Open, FileAccess.Read, FileShare.ReadWrite);
+
+            chunkAvailable = new bool[(int)((fileLength + chunkSize - 1) / chunkSize)];
+
+            getBlock = new FPDF_GetBlock(GetBlock);
+            fileAccess = Marshal.AllocHGlobal(Marshal.SizeOf(typeof(FPDF_FILEACCESS)));
+            Marshal.StructureToPtr(new FPDF_FILEACCESS()
+            {
+                m_FileLen = (uint)fileLength,
+                m_GetBlock = Marshal.GetFunctionPointerForDelegate(getBlock),
+                m_Param = IntPtr.Zero
+            }, fileAccess, false);
+
+            isDataAvail = new FX_IsDataAvail(IsDataAvail);
+            fileAvail = Marshal.AllocHGlobal(Marshal.SizeOf(typeof(FX_FILEAVAIL)));
+            Marshal.StructureToPtr(new FX_FILEAVAIL()
+            {
+                version = 1,
+                IsDataAvail = Marshal.GetFunctionPointerForDelegate(isDataAvail)
+            }, fileAvail, false);
+
+            addSegment = new FX_AddSegment(AddSegment);
+            hints = Marshal.AllocHGlobal(Marshal.SizeOf(typeof(FX_DOWNLOADHINTS)));
+            Marshal.StructureToPtr(new FX_DOWNLOADHINTS()
+            {
+                version = 1,
+                AddSegment = Marshal.GetFunctionPointerForDelegate(addSegment)
+            }, hints, false);
+
+            copyThread = new Thread(CopyChunks);
+            copyThread.IsBackground = true;
+            copyThread.Start();
+
+            avail = FoxitPDFSDK.FPDFAvail_Create(fileAvail, fileAccess);
+        }
+
+        public void Dispose()
+        {
+            lock (chunkLock)
+            {
+                stopCopying = true;
+                Monitor.PulseAll(chunkLock);
+            }
+            copyThread.Join();
+
+            if (reader != null)
+            {
+                reader.Dispose();
+            }
+            FoxitPDFSDK.FPDFAvail_Destroy(avail);
+
+            Marshal.FreeHGlobal(hints);
+            Marshal.FreeHGlobal(fileAvail);
+            Marshal.FreeHGlobal(fileAccess);
+
+            localReader.Dispose();
+            localWriter.Dispose();
+            sourceStream.Dispose();
+            File.Delete(localPath);
+        }
+
+        public bool IsLinearized()
+        {
+            WaitForData(0, Math.Min(1024, fileLength));
+            return FoxitPDFSDK.FPDFAvail_IsLinearized(avail) == 1;
+        }
+
+        public int GetPageCount()
+        {
+            return GetReader().GetPageCount();
+        }
+
+        /// <summary>
+        /// Wait until the page has arrived and render it as planned, a batch of
+        /// one page as the render cache wraps it.
+        /// </summary>
+        public Bitmap[] RenderBatch(int pageIndex, PagePlanner planner)
+        {
+            var pdfReader = GetReader();
+            while (true)
+            {
+                int arrivedChunks = GetArrivedChunkCount();
+                if (FoxitPDFSDK.FPDFAvail_IsPageAvail(avail, pageIndex, hints) != 0)
+                {
+                    break;
+                }
+                WaitForMoreData(arrivedChunks);
+            }
+
+            Bitmap page = pdfReader.RenderPage(pageIndex, planner.GetPlan(pageIndex));
+            if (firstPageTime == TimeSpan.Zero)
+            {
+                firstPageTime = DateTime.Now - startTime;
+            }
+
+            return new Bitmap[] { page };
+        }
+
+        /// <summary>
+        /// Reader for text and other page data. Only pages RenderBatch has waited
+        /// for are known to be available.
+        /// </summary>
+        public FoxitPDFReader GetTextReader()
+        {
+            return GetReader();
+        }
+
+        FoxitPDFReader GetReader()
+        {
+            if (reader == null)
+            {
+                while (true)
+                {
+                    int arrivedChunks = GetArrivedChunkCount();
+                    if (FoxitPDFSDK.FPDFAvail_IsDocAvail(avail, hints) != 0)
+                    {
+                        break;
+                    }
+                    WaitForMoreData(arrivedChunks);
+                }
+
+                IntPtr document = FoxitPDFSDK.FPDFAvail_GetDocument(avail);
+                if (document == IntPtr.Zero)
+                {
+                    throw new IOException(string.Format("Failed to load PDF, error {0}", FoxitPDFSDK.FPDF_GetLastError()));
+                }
+
+                reader = new FoxitPDFReader(document);
+            }
+
+            return reader;
+        }
+
+        void WaitForData(long offset, long size)
+        {
+            while (true)
+            {
+                int arrivedChunks = GetArrivedChunkCount();
+                if (IsRangeAvailable(offset, size))
+                {
+                    break;
+                }
+                WaitForMoreData(arrivedChunks);
+            }
+        }
+
+        int GetArrivedChunkCount()
+        {
+            lock (chunkLock)
+            {
+                return availableChunkCount;
+            }
+        }
+
+        /// <summary>
+        /// Block until more chunks than arrivedChunks have been copied.
+        /// </summary>
+        void WaitForMoreData(int arrivedChunks)
+        {
+            lock (chunkLock)
+            {
+                ++waitCount;
+                while (availableChunkCount == arrivedChunks)
+                {
+                    if (copyError != null)
+                    {
+                        throw new IOException("Failed to copy PDF", copyError);
+                    }
+
+                    if (availableChunkCount == chunkAvailable.Length)
+                    {
+                        throw new IOException("PDF is complete but the SDK still reports missing data");
+                    }
+
+                    Monitor.Wait(chunkLock, 100);
+                }
+            }
+        }
+
+        bool IsRangeAvailable(long offset, long size)
+        {
+            if (size <= 0)
+            {
+                return true;
+            }
+
+            int firstChunk = (int)(offset / chunkSize);
+            int lastChunk = (int)Math.Min((offset + size - 1) / chunkSize, chunkAvailable.Length - 1);
+
+            lock (chunkLock)
+            {
+                for (int chunk = firstChunk; chunk <= lastChunk; ++chunk)
+                {
+                    if (!chunkAvailable[chunk])
+                    {
+                        return false;
+                    }
+                }
+            }
+
+            return true;
+        }
+
+        bool IsDataAvail(IntPtr pThis, UIntPtr offset, UIntPtr size)
+        {
+            if (IsRangeAvailable((long)offset.ToUInt64(), (long)size.ToUInt64()))
+            {
+                return true;
+            }
+
+            // The SDK is blocked on this range, fetch it next.
+            AddSegment(pThis, offset, size);
+            return false;
+        }
+
+        void AddSegment(IntPtr pThis, UIntPtr offset, UIntPtr size)
+        {
+            long start = (long)offset.ToUInt64();
+            long end = Math.Min(start + (long)size.ToUInt64(), fileLength);
+
+            lock (chunkLock)
+            {
+                for (long chunkStart = start - start % chunkSize; chunkStart < end; chunkStart += chunkSize)
+                {
+                    int chunk = (int)(chunkStart / chunkSize);
+                    if (!chunkAvailable[chunk])
+                    {
+                        priorityChunks.Enqueue(chunk);
+                    }
+                }
+            }
+        }
+
+        int GetBlock(IntPtr param, uint position, IntPtr buffer, uint size)
+        {
+            // The local file is sized up front, a range that has not arrived
+            // reads as zeros. Pages nobody waited for, such as the target page
+            // of a link ahead of the copy, are fetched first and waited for here.
+            if (!IsRangeAvailable(position, size))
+            {
+                AddSegment(param, new UIntPtr(position), new UIntPtr(size));
+                try
+                {
+                    WaitForData(position, size);
+                }
+                catch (IOException)
+                {
+                    return 0;
+                }
+            }
+
+            byte[] block = new byte[size];
+            lock (localReader)
+            {
+                localReader.Seek(position, SeekOrigin.Begin);
+                int read = 0;
+                while (read < block.Length)
+                {
+                    int count = localReader.Read(block, read, block.Length - read);
+                    if (count <= 0)
+                    {
+                        return 0;
+                    }
+                    read += count;
+                }
+            }
+
+            Marshal.Copy(block, 0, buffer, block.Length);
+            return 1;
+        }
+
+        void CopyChunks()
+        {
+            byte[] buffer = new byte[chunkSize];
+            try
+            {
+                while (true)
+                {
+                    int chunk = -1;
+                    bool prioritized = false;
+                    lock (chunkLock)
+                    {
+                        if (stopCopying)
+                        {
+                            return;
+                        }
+
+                        while (priorityChunks.Count > 0 && chunk < 0)
+                        {
+                            int candidate = priorityChunks.Dequeue();
+                            if (!chunkAvailable[candidate])
+                            {
+                                chunk = candidate;
+                                prioritized = true;
+                            }
+                        }
+
+                        while (chunk < 0 && nextSequentialChunk < chunkAvailable.Length)
+                        {
+                            if (!chunkAvailable[nextSequentialChunk])
+                            {
+                                chunk = nextSequentialChunk;
+                            }
+                            ++nextSequentialChunk;
+                        }
+
+                        if (chunk < 0)
+                        {
+                            return;
+                        }
+                    }
+
+                    long offset = (long)chunk * chunkSize;
+                    int length = (int)Math.Min(chunkSize, fileLength - offset);
+                    sourceStream.Seek(offset, SeekOrigin.Begin);
+                    int read = 0;
+                    while (read < length)
+                    {
+                        int count = sourceStream.Read(buffer, read, length - read);
+                        if (count <= 0)
+                        {
+                            throw new EndOfStreamException();
+                        }
+                        read += count;
+                    }
+
+                    localWriter.Seek(offset, SeekOrigin.Begin);
+                    localWriter.Write(buffer, 0, length);
+                    localWriter.Flush();
+
+                    lock (chunkLock)
+                    {
+                        chunkAvailable[chunk] = true;
+                        ++availableChunkCount;
+                        if (prioritized)
+                        {
+                            ++prioritizedChunkCount;
+                        }
+                        Monitor.PulseAll(chunkLock);
+                    }
+                }
+            }
+            catch (Exception ex)
+            {
+                lock (chunkLock)
+                {
+                    copyError = ex;
+                    Monitor.PulseAll(chunkLock);
+                }
+            }
+        }
+
+        public string GetStatistics()
+        {
+            lock (chunkLock)
+            {
+                return string.Format("Arriving source {0} bytes, {1} / {2} chunks copied ({3} by download hints), {4} waits, first page after {5:F1}s",
+                    fileLength,
+                    availableChunkCount,
+                    chunkAvailable.Length,
+                    prioritizedChunkCount,
+                    waitCount,
+                    firstPageTime.TotalSeconds);
+            }
+        }
+    }
+}
@@ -6,21 +6,84 @@ using System.IO;
 
 namespace ZwcBookMaker
 {
+    /// <summary>
+    /// Package layout: int slots, slot 0 is the offset of the section directory
+    /// (0 when there is none), slots 1..N are page offsets and slot N+1 is the
+    /// end of the last page. Pages follow, then the section data, then the
+    /// directory: [int count] and per section [4 byte tag][int offset][int length].
+    /// Readers that only know pages ignore slot 0, they can open a package as
+    /// long as every page has bytes of its own and is a GIF.
+    ///
+    /// A page with the same bytes as an earlier one is stored once. Its slot is
+    /// where the next page starts, so it has no bytes of its own, and the PDUP
+    /// section names the page holding them: [int count] and per page
+    /// [int page][int stored page]. A package with PDUP needs a reader that
+    /// knows it, an older one opens such a page as an empty stream and fails.
+    ///
+    /// With symbols set, GIF pages are coded against a book-wide symbol dictionary
+    /// when that makes them smaller, see SymbolCodec. With progressive set they
+    /// get a coarse base layer in front, see ProgressivePage.
+    /// </summary>
     public class BookPackager
     {
-        public static void PackageBook(string pageFolder, int totalPageCount)
+        public const string DuplicateSectionTag = "PDUP";
+
+        public static void PackageBook(string pageFolder, int totalPageCount, Dictionary<string, byte[]> sections = null, bool progressive = false, bool symbols = false)
         {
             MemoryStream header = new MemoryStream();
             MemoryStream body = new MemoryStream();
 
+            // Stored pages by the hash of their bytes.
+            Dictionary<ulong, List<KeyValuePair<int, byte[]>>> storedPages = new Dictionary<ulong, List<KeyValuePair<int, byte[]>>>();
+            MemoryStream duplicates = new MemoryStream();
+            int duplicateCount = 0;
+
+            SymbolCodec symbolCodec = new SymbolCodec();
+            for (int pageIndex = 1; symbols && pageIndex <= totalPageCount; ++pageIndex)
+            {
+                string pageFilePath = GetPageFilePath(pageFolder, pageIndex);
+                if (IsImagePage(pageFilePath))
+                {
+                    symbolCodec.AddPage(File.ReadAllBytes(pageFilePath));
+                }
+            }
+            byte[] symbolSection = symbolCodec.BuildDictionary();
+
             int location = (totalPageCount +  2) * 4;
             WriteInt(header, 0);
             for (int pageIndex = 1; pageIndex <= totalPageCount; ++pageIndex)
             {
-                string pageFilePath = Path.Combine(pageFolder, string.Format("{0:D4}.gif", pageIndex));
+                string pageFilePath = GetPageFilePath(pageFolder, pageIndex);
                 var content = File.ReadAllBytes(pageFilePath);
+                if (IsImagePage(pageFilePath))
+                {
+                    content = EncodeImagePage(symbolCodec, content, symbols, progressive);
+                }
 
                 WriteInt(header, location);
+
+                ulong hash = HashContent(content);
+                List<KeyValuePair<int, byte[]>> candidates;
+                if (!storedPages.TryGetValue(hash, out candidates))
+                {
+                    candidates = new List<KeyValuePair<int, byte[]>>();
+                    storedPages[hash] = candidates;
+                }
+
+                // Equal hashes are checked byte by byte.
+                int storedPage = candidates
+                    .Where(candidate => candidate.Value.Length == content.Length && candidate.Value.SequenceEqual(content))
+                    .Select(candidate => candidate.Key)
+                    .FirstOrDefault();
+                if (storedPage > 0)
+                {
+                    WriteInt(duplicates, pageIndex);
+                    WriteInt(duplicates, storedPage);
+                    ++duplicateCount;
+                    continue;
+                }
+
+                candidates.Add(new KeyValuePair<int, byte[]>(pageIndex, content));
                 WriteBytes(body, content);
 
                 location += content.Length;
@@ -28,6 +91,40 @@ namespace ZwcBookMaker
 
             WriteInt(header, location);
 
+            if (duplicateCount > 0 || symbolCodec.EncodedPageCount > 0)
+            {
+                sections = sections != null ? new Dictionary<string, byte[]>(sections) : new Dictionary<string, byte[]>();
+            }
+            if (duplicateCount > 0)
+            {
+                sections[DuplicateSectionTag] = BitConverter.GetBytes(duplicateCount).Concat(duplicates.ToArray()).ToArray();
+            }
+            if (symbolCodec.EncodedPageCount > 0)
+            {
+                sections[SymbolCodec.SectionTag] = symbolSection;
+            }
+
+            if (sections != null && sections.Count > 0)
+            {
+                MemoryStream directory = new MemoryStream();
+                WriteInt(directory, sections.Count);
+                foreach (var section in sections)
+                {
+                    WriteBytes(directory, Encoding.ASCII.GetBytes(section.Key));
+                    WriteInt(directory, location);
+                    WriteInt(directory, section.Value.Length);
+
+                    WriteBytes(body, section.Value);
+                    location += section.Value.Length;
+                }
+
+                WriteBytes(body, directory.ToArray());
+
+                header.Seek(0, SeekOrigin.Begin);
+                WriteInt(header, location);
+                header.Seek(0, SeekOrigin.End);
+            }
+
             body.Seek(0, SeekOrigin.Begin);
             body.CopyTo(header);
 
@@ -37,6 +134,95 @@ namespace ZwcBookMaker
             File.WriteAllBytes(bookPath, bookPackage);
         }
 
+        /// <summary>
+        /// A GIF page as stored in the package, after the first pass of the codec.
+        /// </summary>
+        internal static byte[] EncodeImagePage(SymbolCodec symbolCodec, byte[] gif, bool symbols, bool progressive)
+        {
+            byte[] content = (symbols ? symbolCodec.EncodePage(gif) : null) ?? gif;
+
+            byte[] levels = progressive ? symbolCodec.ReadPage(gif) : null;
+            if (levels != null)
+            {
+                content = ProgressivePage.Encode(levels, content);
+            }
+
+            return content;
+        }
+
+        /// <summary>
+        /// Delete the pages of an earlier build, which may have been in the other
+        /// mode, so that only pages of this build are packaged.
+        /// </summary>
+        public static void ClearPages(string pageFolder)
+        {
+            foreach (string pattern in new[] { "*.gif", "*.zrf" })
+            {
+                foreach (string pageFilePath in Directory.GetFiles(pageFolder, pattern))
+                {
+                    File.Delete(pageFilePath);
+                }
+            }
+        }
+
+        /// <summary>
+        /// Pages are GIF images, or glyph runs when the book was built in reflow
+        /// mode. Reflow writes a GIF for pages it cannot reflow.
+        /// </summary>
+        static string GetPageFilePath(string pageFolder, int pageIndex)
+        {
+            string glyphRunPath = Path.Combine(pageFolder, string.Format("{0:D4}.zrf", pageIndex));
+            if (File.Exists(glyphRunPath))
+            {
+                return glyphRunPath;
+            }
+            return Path.Combine(pageFolder, string.Format("{0:D4}.gif", pageIndex));
+        }
+
+        /// <summary>
+        /// 64 bit hash of a page, eight bytes per step with the multiply and
+        /// rotate rounds of xxHash64. Only used to find candidates, which are
+        /// compared in full.
+        /// </summary>
+        internal static unsafe ulong HashContent(byte[] content)
+        {
+            const ulong prime1 = 11400714785074694791UL;
+            const ulong prime2 = 14029467366897019727UL;
+            const ulong prime3 = 1609587929392839161UL;
+            const ulong prime5 = 2870177450012600261UL;
+
+            ulong hash = prime5 + (ulong)content.Length;
+            fixed (byte* start = content)
+            {
+                byte* data = start;
+                byte* end = start + content.Length;
+                for (; data + 8 <= end; data += 8)
+                {
+                    ulong lane = *(ulong*)data * prime2;
+                    lane = ((lane << 31) | (lane >> 33)) * prime1;
+                    hash ^= lane;
+                    hash = ((hash << 27) | (hash >> 37)) * prime1 + prime3;
+                }
+                for (; data < end; ++data)
+                {
+                    hash ^= *data * prime5;
+                    hash = ((hash << 11) | (hash >> 53)) * prime1;
+                }
+            }
+
+            hash ^= hash >> 33;
+            hash *= prime2;
+            hash ^= hash >> 29;
+            hash *= prime3;
+            hash ^= hash >> 32;
+            return hash;
+        }
+
+        static bool IsImagePage(string pageFilePath)
+        {
+            return Path.GetExtension(pageFilePath) == ".gif";
+        }
+
         static void WriteBytes(Stream stream, byte[] bytes)
         {
             stream.Write(bytes, 0, bytes.Length);
@@ -0,0 +1,19 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Linq;
+using System.Text;
+
+namespace ZwcBookMaker
+{
+    /// <summary>
+    /// An outline entry of the PDF. Y is the row of the destination in pixels
+    /// of the page rendered by RenderPage, 0 when the destination has no position.
+    /// </summary>
+    public class Bookmark
+    {
+        public int Level;
+        public string Title;
+        public int PageIndex;
+        public int Y;
+    }
+}
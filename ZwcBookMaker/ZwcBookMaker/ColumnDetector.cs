@@ -0,0 +1,266 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Linq;
+using System.Text;
+using System.Diagnostics;
+using System.Drawing;
+using System.Drawing.Imaging;
+
+namespace ZwcBookMaker
+{
+    /// <summary>
+    /// Finds the gutter of two column pages from the vertical projection profile
+    /// of the text line and image boxes of the text pre-pass, so each column can
+    /// be rendered on its own at a larger zoom before the page is rendered at all.
+    /// Rows with boxes in the gutter (titles, wide figures) stay full width.
+    /// </summary>
+    public class ColumnDetector
+    {
+        // The gutter is looked for in the middle of the page.
+        const double gutterSearchStart = 0.3;
+        const double gutterSearchEnd = 0.7;
+        const int minGutterWidth = 8;
+
+        // Column blocks lower than this are left full width, about six lines of text.
+        const int minColumnHeight = 96;
+        const int columnMargin = 8;
+        const double maxScale = 2.0;
+
+        // Vector drawings have no box in the pre-pass, bands this tall without
+        // text or images may hold one and stay full width.
+        const int maxBlankBand = 48;
+
+        int pageCount = 0;
+        int multiColumnPageCount = 0;
+        TimeSpan detectTime = TimeSpan.Zero;
+
+        /// <summary>
+        /// Regions of a page of the given size in pixels of RenderPage, from top
+        /// to bottom, null when it has one column. contentBounds receives the
+        /// columns the boxes cover over the full page height, empty for a page
+        /// without text or images.
+        /// </summary>
+        public List<PageRegion> Detect(Size pageSize, PageText pageText, out Rectangle contentBounds)
+        {
+            var stopwatch = Stopwatch.StartNew();
+
+            Rectangle page = new Rectangle(Point.Empty, pageSize);
+            List<Rectangle> boxes = pageText.Lines
+                .Concat(pageText.Images)
+                .Select(box => Rectangle.Intersect(box, page))
+                .Where(box => box.Width > 0 && box.Height > 0)
+                .ToList();
+            List<PageRegion> regions = DetectColumns(pageSize.Width, pageSize.Height, boxes, out contentBounds);
+
+            detectTime += stopwatch.Elapsed;
+            ++pageCount;
+            if (regions != null)
+            {
+                ++multiColumnPageCount;
+            }
+
+            return regions;
+        }
+
+        List<PageRegion> DetectColumns(int width, int height, List<Rectangle> boxes, out Rectangle contentBounds)
+        {
+            int[] columnInk = new int[width];
+            int[] rowFirst = new int[height];
+            int[] rowLast = new int[height];
+            ScanBoxes(boxes, columnInk, rowFirst, rowLast);
+            contentBounds = GetContentBounds(rowFirst, rowLast);
+
+            int inkRows = rowFirst.Count(first => first >= 0);
+            if (inkRows < minColumnHeight)
+            {
+                return null;
+            }
+
+            // The least covered pixel column in the middle, widened over the pixel
+            // columns that are about as clean. Titles crossing the gutter are allowed.
+            int searchStart = (int)(width * gutterSearchStart);
+            int searchEnd = (int)(width * gutterSearchEnd);
+            int minX = searchStart;
+            for (int x = searchStart; x < searchEnd; ++x)
+            {
+                if (columnInk[x] < columnInk[minX])
+                {
+                    minX = x;
+                }
+            }
+
+            int threshold = columnInk[minX] + inkRows / 20;
+            int gutterLeft = minX;
+            int gutterRight = minX + 1;
+            while (gutterLeft > searchStart && columnInk[gutterLeft - 1] <= threshold)
+            {
+                --gutterLeft;
+            }
+            while (gutterRight < searchEnd && columnInk[gutterRight] <= threshold)
+            {
+                ++gutterRight;
+            }
+
+            if (gutterRight - gutterLeft < minGutterWidth)
+            {
+                return null;
+            }
+
+            bool[] crossing = FindCrossing(boxes, height, gutterLeft, gutterRight, rowFirst);
+
+            // Runs of rows without ink in the gutter and with ink on both sides are
+            // column blocks, everything between them spans the page.
+            List<PageRegion> regions = new List<PageRegion>();
+            int spanTop = 0;
+            int y = 0;
+            while (y < height)
+            {
+                if (crossing[y])
+                {
+                    ++y;
+                    continue;
+                }
+
+                int blockTop = y;
+                int left = gutterLeft;
+                int right = gutterRight;
+                while (y < height && !crossing[y])
+                {
+                    if (rowFirst[y] >= 0)
+                    {
+                        left = Math.Min(left, rowFirst[y]);
+                        right = Math.Max(right, rowLast[y] + 1);
+                    }
+                    ++y;
+                }
+
+                if (y - blockTop >= minColumnHeight && left < gutterLeft && right > gutterRight)
+                {
+                    if (blockTop > spanTop)
+                    {
+                        regions.Add(new PageRegion() { Bounds = new Rectangle(0, spanTop, width, blockTop - spanTop), Scale = 1 });
+                    }
+
+                    int middle = (gutterLeft + gutterRight) / 2;
+                    left = Math.Max(0, left - columnMargin);
+                    right = Math.Min(width, right + columnMargin);
+                    double scale = Math.Min(maxScale, (double)width / Math.Max(middle - left, right - middle));
+
+                    regions.Add(new PageRegion() { Bounds = Rectangle.FromLTRB(left, blockTop, middle, y), Scale = scale });
+                    regions.Add(new PageRegion() { Bounds = Rectangle.FromLTRB(middle, blockTop, right, y), Scale = scale });
+                    spanTop = y;
+                }
+            }
+
+            if (regions.Count == 0)
+            {
+                return null;
+            }
+
+            if (height > spanTop)
+            {
+                regions.Add(new PageRegion() { Bounds = new Rectangle(0, spanTop, width, height - spanTop), Scale = 1 });
+            }
+
+            return regions;
+        }
+
+        /// <summary>
+        /// The boxes cover the columns between the leftmost and rightmost box, the
+        /// full page height is kept, see maxBlankBand.
+        /// </summary>
+        static Rectangle GetContentBounds(int[] rowFirst, int[] rowLast)
+        {
+            int left = int.MaxValue;
+            int right = -1;
+            for (int y = 0; y < rowFirst.Length; ++y)
+            {
+                if (rowFirst[y] >= 0)
+                {
+                    left = Math.Min(left, rowFirst[y]);
+                    right = Math.Max(right, rowLast[y] + 1);
+                }
+            }
+
+            return right < 0 ? Rectangle.Empty : Rectangle.FromLTRB(left, 0, right, rowFirst.Length);
+        }
+
+        /// <summary>
+        /// Count the covered rows of each pixel column and find the first and last
+        /// covered pixel of each row, -1 for blank rows.
+        /// </summary>
+        static void ScanBoxes(List<Rectangle> boxes, int[] columnInk, int[] rowFirst, int[] rowLast)
+        {
+            for (int y = 0; y < rowFirst.Length; ++y)
+            {
+                rowFirst[y] = -1;
+                rowLast[y] = -1;
+            }
+
+            // Covered rows of overlapping boxes are counted once per box, the
+            // profile only has to find the least covered columns.
+            foreach (var box in boxes)
+            {
+                for (int x = box.Left; x < box.Right; ++x)
+                {
+                    columnInk[x] += box.Height;
+                }
+                for (int y = box.Top; y < box.Bottom; ++y)
+                {
+                    rowFirst[y] = rowFirst[y] < 0 ? box.Left : Math.Min(rowFirst[y], box.Left);
+                    rowLast[y] = Math.Max(rowLast[y], box.Right - 1);
+                }
+            }
+        }
+
+        /// <summary>
+        /// Rows with a box between left and right, and bands of blank rows taller
+        /// than maxBlankBand.
+        /// </summary>
+        static bool[] FindCrossing(List<Rectangle> boxes, int height, int left, int right, int[] rowFirst)
+        {
+            bool[] crossing = new bool[height];
+            foreach (var box in boxes.Where(box => box.Left < right && box.Right > left))
+            {
+                for (int y = box.Top; y < box.Bottom; ++y)
+                {
+                    crossing[y] = true;
+                }
+            }
+
+            int bandTop = 0;
+            while (bandTop < height)
+            {
+                if (rowFirst[bandTop] >= 0)
+                {
+                    ++bandTop;
+                    continue;
+                }
+
+                int bandEnd = bandTop;
+                while (bandEnd < height && rowFirst[bandEnd] < 0)
+                {
+                    ++bandEnd;
+                }
+                if (bandEnd - bandTop > maxBlankBand)
+                {
+                    for (int y = bandTop; y < bandEnd; ++y)
+                    {
+                        crossing[y] = true;
+                    }
+                }
+                bandTop = bandEnd;
+            }
+
+            return crossing;
+        }
+
+        public string GetStatistics()
+        {
+            return string.Format("Columns found on {0} of {1} pages, gutter detection {2:F2} ms per page",
+                multiColumnPageCount,
+                pageCount,
+                pageCount > 0 ? detectTime.TotalMilliseconds / pageCount : 0);
+        }
+    }
+}
@@ -0,0 +1,72 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Linq;
+using System.Text;
+using System.Drawing;
+using System.IO;
+using System.Windows.Forms;
+
+namespace ZwcBookMaker
+{
+    public class ColumnDetectorTest
+    {
+        public void Run()
+        {
+            // A two column paper, the slicer is run with and without columns.
+            string path = Path.Combine(Application.StartupPath, "两栏论文.pdf");
+            string pageFolder = Path.GetTempPath();
+            string fullWidthFolder = Path.Combine(pageFolder, "ColumnTest_FullWidth");
+            string columnFolder = Path.Combine(pageFolder, "ColumnTest_Columns");
+            Directory.CreateDirectory(fullWidthFolder);
+            Directory.CreateDirectory(columnFolder);
+
+            using (var foxitPdf = new FoxitPDFSDK())
+            using (var pdfSource = new MappedPDFSource(path))
+            using (var renderReader = new FoxitPDFReader(pdfSource))
+            using (var regionReader = new FoxitPDFReader(pdfSource))
+            {
+                int pageCount = renderReader.GetPageCount();
+
+                ColumnDetector detector = new ColumnDetector();
+                PageOutPutter fullWidth = new PageOutPutter(fullWidthFolder);
+                PageOutPutter columns = new PageOutPutter(columnFolder);
+                PageText pageText = new PageText();
+
+                for (int pageIndex = 0; pageIndex < pageCount; ++pageIndex)
+                {
+                    renderReader.ExtractText(pageIndex, pageText);
+                    List<Rectangle> textLines = pageText.Lines;
+                    using (Bitmap page = renderReader.RenderPage(pageIndex))
+                    {
+                        fullWidth.AddPage(page, textLines);
+
+                        Rectangle contentBounds;
+                        List<PageRegion> regions = detector.Detect(page.Size, pageText, out contentBounds);
+                        if (regions == null)
+                        {
+                            columns.AddPage(page, textLines);
+                        }
+                        else
+                        {
+                            using (Bitmap stacked = regionReader.RenderPage(pageIndex, regions))
+                            {
+                                columns.AddPage(stacked, regions, textLines);
+                            }
+                        }
+                    }
+                }
+                fullWidth.Flush();
+                columns.Flush();
+
+                MessageBox.Show(string.Format(
+                    "{0} source pages\n{1}\n" +
+                    "Full width: {2}\n" +
+                    "Columns: {3}",
+                    pageCount,
+                    detector.GetStatistics(),
+                    fullWidth.GetStatistics(),
+                    columns.GetStatistics()));
+            }
+        }
+    }
+}
@@ -0,0 +1,59 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Linq;
+using System.Text;
+using System.Drawing;
+using System.IO;
+using System.Windows.Forms;
+
+namespace ZwcBookMaker
+{
+    public class CompactionTest
+    {
+        const int pageCount = 50;
+
+        public void Run()
+        {
+            string path = Path.Combine(Application.StartupPath, "人月神话.pdf");
+
+            using (var foxitPdf = new FoxitPDFSDK())
+            using (var pdfSource = new MappedPDFSource(path))
+            using (var reader = new FoxitPDFReader(pdfSource))
+            {
+                int plainPages = BuildPages(reader, false);
+                int compactedPages = BuildPages(reader, true);
+
+                MessageBox.Show(string.Format(
+                    "{0} source pages: {1} output pages, {2} compacted, {3:P1} fewer page turns",
+                    Math.Min(pageCount, reader.GetPageCount()),
+                    plainPages,
+                    compactedPages,
+                    plainPages > 0 ? 1 - (double)compactedPages / plainPages : 0));
+            }
+        }
+
+        static int BuildPages(FoxitPDFReader reader, bool compact)
+        {
+            string folder = Path.Combine(Path.GetTempPath(), "CompactionTest");
+            Directory.CreateDirectory(folder);
+
+            PageOutPutter outPutter = new PageOutPutter(folder);
+            outPutter.CompactWhitespace = compact;
+            PageText pageText = new PageText();
+
+            int count = Math.Min(pageCount, reader.GetPageCount());
+            for (int pageIndex = 0; pageIndex < count; ++pageIndex)
+            {
+                reader.ExtractText(pageIndex, pageText);
+                using (Bitmap page = reader.RenderPage(pageIndex))
+                {
+                    outPutter.AddPage(page, pageText.Lines);
+                }
+            }
+            outPutter.Flush();
+
+            Directory.Delete(folder, true);
+            return outPutter.GetOutputPageCount();
+        }
+    }
+}
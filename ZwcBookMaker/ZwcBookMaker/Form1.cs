@@ -8,14 +8,17 @@ using System.Text;
 using System.Windows.Forms;
 using System.Drawing.Imaging;
 using System.Threading;
-using Acrobat;
 using System.IO;
 using zwcHelper;
+using Glassesol.Common;
 
 namespace ZwcBookMaker
 {
     public partial class Form1 : Form
     {
+        const long renderCacheSize = 2L * 1024 * 1024 * 1024;
+        public const string ConfigFileName = "ZwcBookMaker.config";
+
         public Form1()
         {
             InitializeComponent();
@@ -23,7 +26,16 @@ namespace ZwcBookMaker
 
         private void Form1_Load(object sender, EventArgs e)
         {
-            //new AcrobatTest().Run();
+            //new ReflowTest().Run();
+            //new ColumnDetectorTest().Run();
+            //new TextExtractionTest().Run();
+            //new GrayQuantizerTest().Run();
+            //new SupersamplerTest().Run();
+            //new RotationTest().Run();
+            //new ScanPageTest().Run();
+            //new CompactionTest().Run();
+            //new SymbolCodecTest().Run();
+            //new TranscoderTest().Run();
             Form1_DragLeave(null, null);
         }
         private void Form1_DragEnter(object sender, DragEventArgs e)
@@ -82,44 +94,190 @@ namespace ZwcBookMaker
             {
                 Directory.CreateDirectory(pageFolder);
             }
+            BookPackager.ClearPages(pageFolder);
+
+            SettingsProvider buildConfig = new SettingsProvider();
+            buildConfig.LoadSettings(Path.Combine(Application.StartupPath, ConfigFileName));
 
-            Action<Action> invokeAction = (action) =>
+            using (var foxitPdf = new FoxitPDFSDK())
+            using (var memoryManager = new MemoryManager())
             {
-                this.Invoke(action);
-            };
+                if (IsOnSlowStorage(file))
+                {
+                    BuildFromArrivingFile(file, pageFolder, buildConfig, memoryManager, e);
+                }
+                else
+                {
+                    BuildFromMappedFile(file, pageFolder, buildConfig, memoryManager, e);
+                }
+
+                WriteLog(file, memoryManager.GetStatistics());
+            }
+
+            backgroundWorker1.ReportProgress(0, "Done");
+        }
 
-            using (var pdfReader = new AcrobatPDFReader(file, invokeAction))
+        void BuildFromMappedFile(string file, string pageFolder, SettingsProvider buildConfig, MemoryManager memoryManager, DoWorkEventArgs e)
+        {
+            using (var pdfSource = new MappedPDFSource(file))
             {
-                int totalPageCount = pdfReader.GetPageCount();
-                int renderedPageCount = 0;
-                PageOutPutter outPutter = new PageOutPutter(pageFolder);
+                if (buildConfig["Mode"] == "Reflow")
+                {
+                    using (var textReader = new FoxitPDFReader(pdfSource))
+                    {
+                        BuildReflowBook(pageFolder, textReader, memoryManager, e);
+                    }
+                    WriteLog(file, pdfSource.GetStatistics());
+                    return;
+                }
 
-                while (renderedPageCount < totalPageCount && !e.Cancel)
+                // One document handle for text and rendering, the SDK is not
+                // documented as thread safe, see FoxitPDFSDK.SyncRoot.
+                using (var pdfReader = new FoxitPDFReader(pdfSource))
                 {
-                    Bitmap page = pdfReader.RenderPage(renderedPageCount);
+                    RenderCache renderCache = new RenderCache(Path.Combine(Application.StartupPath, "RenderCache"), file, pdfReader.GetRenderOptions(), renderCacheSize);
+
+                    PagePlanner planner = new PagePlanner(pdfReader);
+                    Func<int, Bitmap[]> renderBatch = renderCache.Wrap(pageIndex => new Bitmap[] { pdfReader.RenderPage(pageIndex, planner.GetPlan(pageIndex)) }, planner, pdfReader.GetPageCount());
+                    BuildBook(file, pageFolder, pdfReader.GetPageCount(), renderBatch, pdfReader, planner, buildConfig, memoryManager, e);
+                    WriteLog(file, pdfSource.GetStatistics() + Environment.NewLine + renderCache.GetStatistics());
+                }
+            }
+        }
+
+        /// <summary>
+        /// Copy the PDF to a local file and start rendering as soon as the SDK
+        /// reports the first pages available. The render cache is not used here,
+        /// its key needs the hash of the whole file.
+        /// </summary>
+        void BuildFromArrivingFile(string file, string pageFolder, SettingsProvider buildConfig, MemoryManager memoryManager, DoWorkEventArgs e)
+        {
+            string localPath = Path.Combine(Path.GetTempPath(), Path.GetFileName(file));
+            using (var pdfSource = new ArrivingPDFSource(file, localPath))
+            {
+                backgroundWorker1.ReportProgress(0, pdfSource.IsLinearized() ? "开始生成" : "等待文件复制完成");
+
+                PagePlanner planner = new PagePlanner(pdfSource.GetTextReader());
+                BuildBook(file, pageFolder, pdfSource.GetPageCount(), pageIndex => pdfSource.RenderBatch(pageIndex, planner), pdfSource.GetTextReader(), planner, buildConfig, memoryManager, e);
+                WriteLog(file, pdfSource.GetStatistics());
+            }
+        }
+
+        void BuildBook(string file, string pageFolder, int totalPageCount, Func<int, Bitmap[]> renderBatch, FoxitPDFReader textReader, PagePlanner planner, SettingsProvider buildConfig, MemoryManager memoryManager, DoWorkEventArgs e)
+        {
+            memoryManager.BeginStage("Render");
 
-                    //string pagePath = Path.Combine(pageFolder, renderedPageCount.ToString() + ".png");
-                    //page.Save(pagePath, ImageFormat.Png);
+            int renderedPageCount = 0;
+            PageOutPutter outPutter = new PageOutPutter(pageFolder);
+            outPutter.CompactWhitespace = buildConfig["Compact"] == "True";
+
+            SearchIndexBuilder searchIndex = new SearchIndexBuilder();
+            TocBuilder toc = new TocBuilder();
+            LinkTableBuilder linkTable = new LinkTableBuilder();
+            List<IPackageSection> sections = new List<IPackageSection>() { searchIndex, new TextLayerBuilder(), toc, new PageMapBuilder(), linkTable };
+
+            while (renderedPageCount < totalPageCount && !e.Cancel)
+            {
+                foreach (Bitmap page in renderBatch(renderedPageCount))
+                {
+                    // Planned and extracted by the text pre-pass before the page was rendered.
+                    List<PageRegion> regions;
+                    PageText pageText = planner.TakeText(renderedPageCount, out regions);
+                    if (regions == null)
+                    {
+                        outPutter.AddPage(page, pageText.Lines);
+                    }
+                    else
+                    {
+                        outPutter.AddPage(page, regions, pageText.Lines);
+                    }
+                    page.Dispose();
 
-                    outPutter.AddPage(page);
+                    foreach (var section in sections)
+                    {
+                        section.AddSourcePage(textReader, pageText);
+                    }
 
                     ++renderedPageCount;
+                }
+
+                string progress = string.Format("{0} / {1}", renderedPageCount, totalPageCount);
+                backgroundWorker1.ReportProgress(0, progress);
+            }
+
+            outPutter.Flush();
+
+            Dictionary<string, byte[]> sectionData = new Dictionary<string, byte[]>();
+            foreach (var section in sections)
+            {
+                sectionData[section.Tag] = section.Build(textReader, outPutter);
+            }
+            WriteLog(file, searchIndex.GetStatistics() + Environment.NewLine + toc.GetStatistics() + Environment.NewLine + linkTable.GetStatistics());
+            WriteLog(file, planner.GetStatistics() + Environment.NewLine + outPutter.GetStatistics());
+
+            PackageBook(pageFolder, outPutter.GetOutputPageCount(), memoryManager, sectionData, buildConfig["Progressive"] == "True", buildConfig["Symbols"] == "True");
+        }
 
-                    string progress = string.Format("{0} / {1}", renderedPageCount, totalPageCount);
-                    backgroundWorker1.ReportProgress(0, progress);
+        /// <summary>
+        /// Text pages are reflowed for the reader screen, pages without text
+        /// (figures, scans) are rendered and added as images.
+        /// </summary>
+        void BuildReflowBook(string pageFolder, FoxitPDFReader textReader, MemoryManager memoryManager, DoWorkEventArgs e)
+        {
+            memoryManager.BeginStage("Reflow");
+
+            int totalPageCount = textReader.GetPageCount();
+            ReflowEngine reflowEngine = new ReflowEngine(pageFolder);
+            PageText pageText = new PageText();
+
+            for (int pageIndex = 0; pageIndex < totalPageCount && !e.Cancel; ++pageIndex)
+            {
+                textReader.ExtractText(pageIndex, pageText);
+                if (!reflowEngine.AddPage(pageText))
+                {
+                    using (Bitmap page = textReader.RenderPage(pageIndex))
+                    {
+                        reflowEngine.AddImagePage(page);
+                    }
                 }
 
-                outPutter.Flush();
+                string progress = string.Format("{0} / {1}", pageIndex + 1, totalPageCount);
+                backgroundWorker1.ReportProgress(0, progress);
+            }
+
+            reflowEngine.Flush();
+
+            PackageBook(pageFolder, reflowEngine.GetOutputPageCount(), memoryManager);
+        }
+
+        void PackageBook(string pageFolder, int outputPageCount, MemoryManager memoryManager, Dictionary<string, byte[]> sections = null, bool progressive = false, bool symbols = false)
+        {
+            memoryManager.BeginStage("Package");
 
-                SettingsProvider settingsProvider = new SettingsProvider();
-                settingsProvider["TotalPages"] = outPutter.GetOutputPageCount().ToString();
-                settingsProvider["CurrentPage"] = "1";
-                settingsProvider.SaveSettings(pageFolder + ".zwc");
+            SettingsProvider settingsProvider = new SettingsProvider();
+            settingsProvider["TotalPages"] = outputPageCount.ToString();
+            settingsProvider["CurrentPage"] = "1";
+            settingsProvider.SaveSettings(pageFolder + ".zwc");
 
-                BookPackager.PackageBook(pageFolder, outPutter.GetOutputPageCount());
+            BookPackager.PackageBook(pageFolder, outputPageCount, sections, progressive, symbols);
+        }
 
-                backgroundWorker1.ReportProgress(0, "Done");
+        bool IsOnSlowStorage(string file)
+        {
+            string root = Path.GetPathRoot(Path.GetFullPath(file));
+            if (root.StartsWith(@"\\"))
+            {
+                return true;
             }
+
+            DriveType driveType = new DriveInfo(root).DriveType;
+            return driveType == DriveType.Network || driveType == DriveType.Removable || driveType == DriveType.CDRom;
+        }
+
+        void WriteLog(string file, string statistics)
+        {
+            LogHelper log = new LogHelper(Path.Combine(Application.StartupPath, "Log"));
+            log.WriteLog(Path.GetFileName(file) + Environment.NewLine + statistics);
         }
 
         private void backgroundWorker1_ProgressChanged(object sender, ProgressChangedEventArgs e)
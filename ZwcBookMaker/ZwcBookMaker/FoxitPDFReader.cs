@@ -0,0 +1,689 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Linq;
+using System.Text;
+using System.Drawing;
+using System.Drawing.Imaging;
+using System.IO;
+
+namespace ZwcBookMaker
+{
+    public class FoxitPDFReader : IDisposable
+    {
+        IntPtr document = IntPtr.Zero;
+        RenderArena arena = new RenderArena();
+
+        // Reused by ExtractText from page to page.
+        ushort[] textBuffer = new ushort[0];
+        Dictionary<IntPtr, int> fontIds = new Dictionary<IntPtr, int>();
+
+        bool supersample = true;
+        bool extractScans = true;
+
+        // Bump when RenderPage gives other pixels for the same options.
+        const string renderVersion = "FoxitSDK3.1-r3";
+
+        // Text render mode of the OCR layer laid over scans.
+        const int invisibleTextMode = 3;
+
+        // How far a scan may be off the page edges, as a share of the page width.
+        const double scanTolerance = 0.02;
+
+        public FoxitPDFReader(MappedPDFSource source)
+        {
+            document = FoxitPDFSDK.FPDF_LoadCustomDocument(source.FileAccess, null);
+            if (document == IntPtr.Zero)
+            {
+                throw new IOException(string.Format("Failed to load PDF, error {0}", FoxitPDFSDK.FPDF_GetLastError()));
+            }
+        }
+
+        /// <summary>
+        /// Take over a document that was already loaded, for example by FPDFAvail_GetDocument.
+        /// </summary>
+        public FoxitPDFReader(IntPtr document)
+        {
+            this.document = document;
+        }
+
+        public void Dispose()
+        {
+            lock (FoxitPDFSDK.SyncRoot)
+            {
+                FoxitPDFSDK.FPDF_CloseDocument(document);
+                arena.Dispose();
+            }
+        }
+
+        public RenderArena Arena
+        {
+            get
+            {
+                return arena;
+            }
+        }
+
+        public int GetPageCount()
+        {
+            return FoxitPDFSDK.FPDF_GetPageCount(document);
+        }
+
+        /// <summary>
+        /// Render pages at twice the size and filter them down, see Supersampler.
+        /// </summary>
+        public bool Supersample
+        {
+            get
+            {
+                return supersample;
+            }
+            set
+            {
+                supersample = value;
+            }
+        }
+
+        /// <summary>
+        /// Take the pixels of scanned pages from their image instead of rendering, see ExtractScan.
+        /// </summary>
+        public bool ExtractScans
+        {
+            get
+            {
+                return extractScans;
+            }
+            set
+            {
+                extractScans = value;
+            }
+        }
+
+        /// <summary>
+        /// Everything that changes the pixels RenderPage gives, for the render cache key.
+        /// </summary>
+        public string GetRenderOptions()
+        {
+            return string.Format("{0}|800|supersample={1}|scans={2}", renderVersion, supersample, extractScans);
+        }
+
+        /// <summary>
+        /// Render a page 800 pixels wide. The bitmap lives in this reader's arena
+        /// and must be disposed before the next page is rendered. Readers on
+        /// other threads wait for the SDK, see FoxitPDFSDK.SyncRoot.
+        /// </summary>
+        public Bitmap RenderPage(int pageIndex)
+        {
+            int widthPixels = 800;
+            int heightPixels;
+            IntPtr renderBuffer, buffer;
+            lock (FoxitPDFSDK.SyncRoot)
+            {
+                // The arena lives on the SDK heap, it is reset and filled under the lock too.
+                arena.Reset();
+
+                IntPtr page = FoxitPDFSDK.FPDF_LoadPage(document, pageIndex);
+                try
+                {
+                    double width = FoxitPDFSDK.FPDF_GetPageWidth(page);
+                    double height = FoxitPDFSDK.FPDF_GetPageHeight(page);
+                    heightPixels = (int)(widthPixels * height / width);
+
+                    Bitmap scan = extractScans ? ExtractScan(page, width, height, widthPixels, heightPixels) : null;
+                    if (scan != null)
+                    {
+                        return scan;
+                    }
+                    renderBuffer = RenderBuffer(page, widthPixels, heightPixels, 0, 0, widthPixels, heightPixels, out buffer);
+                }
+                finally
+                {
+                    FoxitPDFSDK.FPDF_ClosePage(page);
+                }
+            }
+
+            return ToBitmap(renderBuffer, buffer, widthPixels, heightPixels);
+        }
+
+        /// <summary>
+        /// Render the regions of a page planned by PagePlanner, each at its zoom,
+        /// stacked top to bottom at the left of one bitmap 800 pixels wide. With
+        /// no regions this is RenderPage. The stacked bitmap is not in the arena.
+        /// </summary>
+        public Bitmap RenderPage(int pageIndex, List<PageRegion> regions)
+        {
+            if (regions == null)
+            {
+                return RenderPage(pageIndex);
+            }
+
+            Bitmap stacked = new Bitmap(800, regions.Sum(region => region.GetPixelSize().Height), PixelFormat.Format32bppRgb);
+            using (Graphics graphics = Graphics.FromImage(stacked))
+            {
+                graphics.Clear(Color.White);
+                int y = 0;
+                foreach (var region in regions)
+                {
+                    using (Bitmap part = RenderPageRegion(pageIndex, region.Bounds, region.Scale))
+                    {
+                        graphics.DrawImageUnscaled(part, 0, y);
+                    }
+                    y += region.GetPixelSize().Height;
+                }
+            }
+            return stacked;
+        }
+
+        /// <summary>
+        /// Render a part of a page, given in pixels of the page rendered by RenderPage,
+        /// zoomed by scale. The bitmap lives in the arena as for RenderPage, except
+        /// the part of a scan, which is cut from the scan at this zoom.
+        /// </summary>
+        public Bitmap RenderPageRegion(int pageIndex, Rectangle region, double scale)
+        {
+            int widthPixels = Math.Max(1, (int)(region.Width * scale));
+            int heightPixels = Math.Max(1, (int)(region.Height * scale));
+            int startX = -(int)(region.X * scale);
+            int startY = -(int)(region.Y * scale);
+            Bitmap scan;
+            IntPtr renderBuffer = IntPtr.Zero;
+            IntPtr buffer = IntPtr.Zero;
+            lock (FoxitPDFSDK.SyncRoot)
+            {
+                arena.Reset();
+
+                IntPtr page = FoxitPDFSDK.FPDF_LoadPage(document, pageIndex);
+                try
+                {
+                    double width = FoxitPDFSDK.FPDF_GetPageWidth(page);
+                    double height = FoxitPDFSDK.FPDF_GetPageHeight(page);
+
+                    // The whole page at this zoom, moved so the region is at the origin.
+                    int pageWidthPixels = (int)(800 * scale);
+                    int pageHeightPixels = (int)(pageWidthPixels * height / width);
+
+                    scan = extractScans ? ExtractScan(page, width, height, pageWidthPixels, pageHeightPixels) : null;
+                    if (scan == null)
+                    {
+                        renderBuffer = RenderBuffer(page, widthPixels, heightPixels, startX, startY, pageWidthPixels, pageHeightPixels, out buffer);
+                    }
+                }
+                finally
+                {
+                    FoxitPDFSDK.FPDF_ClosePage(page);
+                }
+            }
+
+            if (scan == null)
+            {
+                return ToBitmap(renderBuffer, buffer, widthPixels, heightPixels);
+            }
+
+            using (scan)
+            {
+                Bitmap part = new Bitmap(widthPixels, heightPixels, PixelFormat.Format32bppRgb);
+                using (Graphics graphics = Graphics.FromImage(part))
+                {
+                    graphics.Clear(Color.White);
+                    graphics.DrawImageUnscaled(scan, startX, startY);
+                }
+                return part;
+            }
+        }
+
+        /// <summary>
+        /// Render the page placed at (startX, startY) with the given size into an
+        /// arena buffer, at twice the size when supersampling. Called with the
+        /// SDK lock held, so buffer receives the arena memory of the bitmap as
+        /// well and ToBitmap finishes it without the lock.
+        /// </summary>
+        IntPtr RenderBuffer(IntPtr page, int widthPixels, int heightPixels, int startX, int startY, int pageWidthPixels, int pageHeightPixels, out IntPtr buffer)
+        {
+            int factor = supersample ? 2 : 1;
+            int renderWidth = widthPixels * factor;
+            int renderHeight = heightPixels * factor;
+            int renderStride = renderWidth * 4;
+
+            IntPtr renderBuffer = arena.Allocate((long)renderStride * renderHeight);
+            buffer = supersample ? arena.Allocate((long)widthPixels * 4 * heightPixels) : renderBuffer;
+            IntPtr pdfBitmap = FoxitPDFSDK.FPDFBitmap_CreateEx(renderWidth, renderHeight, BitmapFormat.FPDFBitmap_BGRx, renderBuffer, renderStride);
+            FoxitPDFSDK.FPDFBitmap_FillRect(pdfBitmap, 0, 0, renderWidth, renderHeight, 255, 255, 255, 255);
+            FoxitPDFSDK.FPDF_RenderPageBitmap(pdfBitmap, page, startX * factor, startY * factor, pageWidthPixels * factor, pageHeightPixels * factor, 0, 0);
+            FoxitPDFSDK.FPDFBitmap_Destroy(pdfBitmap);
+            return renderBuffer;
+        }
+
+        /// <summary>
+        /// An arena bitmap over the buffers from RenderBuffer. When supersampling,
+        /// the render buffer is filtered down into buffer in one pass.
+        /// </summary>
+        Bitmap ToBitmap(IntPtr renderBuffer, IntPtr buffer, int widthPixels, int heightPixels)
+        {
+            int renderStride = widthPixels * (supersample ? 2 : 1) * 4;
+            if (!supersample)
+            {
+                return new Bitmap(widthPixels, heightPixels, renderStride, PixelFormat.Format32bppRgb, renderBuffer);
+            }
+
+            int stride = widthPixels * 4;
+            Supersampler.Downsample(renderBuffer, renderStride, buffer, stride, widthPixels, heightPixels);
+
+            return new Bitmap(widthPixels, heightPixels, stride, PixelFormat.Format32bppRgb, buffer);
+        }
+
+        /// <summary>
+        /// A scanned page is one image covering the page, maybe under invisible
+        /// OCR text. Its pixels are scaled straight to the page size into an
+        /// arena bitmap, null for any other page.
+        /// </summary>
+        Bitmap ExtractScan(IntPtr page, double width, double height, int widthPixels, int heightPixels)
+        {
+            IntPtr image = FindPageImage(page, width, height);
+            if (image == IntPtr.Zero)
+            {
+                return null;
+            }
+
+            IntPtr imageBitmap = FoxitPDFSDK.FPDFImageObj_GetBitmap(image);
+            if (imageBitmap == IntPtr.Zero)
+            {
+                return null;
+            }
+
+            try
+            {
+                int imageWidth = FoxitPDFSDK.FPDFBitmap_GetWidth(imageBitmap);
+                int imageHeight = FoxitPDFSDK.FPDFBitmap_GetHeight(imageBitmap);
+                int imageStride = FoxitPDFSDK.FPDFBitmap_GetStride(imageBitmap);
+
+                // The SDK has no call for the format or the colorspace, rows are padded
+                // to at most 4 bytes. One byte per pixel is gray or palette indices,
+                // which cannot be told apart, so only BGR and BGRx images are taken.
+                // 1 and 8 bit images are rendered.
+                int bytesPerPixel = imageWidth >= 16 ? imageStride / imageWidth : 0;
+                if (bytesPerPixel != 3 && bytesPerPixel != 4)
+                {
+                    return null;
+                }
+
+                int stride = widthPixels * 4;
+                IntPtr buffer = arena.Allocate((long)stride * heightPixels);
+                ImageResampler.Resample(FoxitPDFSDK.FPDFBitmap_GetBuffer(imageBitmap), imageWidth, imageHeight, imageStride, bytesPerPixel,
+                    buffer, stride, widthPixels, heightPixels);
+
+                return new Bitmap(widthPixels, heightPixels, stride, PixelFormat.Format32bppRgb, buffer);
+            }
+            finally
+            {
+                FoxitPDFSDK.FPDFBitmap_Destroy(imageBitmap);
+            }
+        }
+
+        /// <summary>
+        /// The only image of a page when it is upright and covers the whole page
+        /// and nothing but invisible text is drawn with it.
+        /// </summary>
+        static IntPtr FindPageImage(IntPtr page, double width, double height)
+        {
+            IntPtr image = IntPtr.Zero;
+            int objectCount = FoxitPDFSDK.FPDFPage_CountObject(page);
+            for (int index = 0; index < objectCount; ++index)
+            {
+                IntPtr pageObject = FoxitPDFSDK.FPDFPage_GetObject(page, index);
+                switch (FoxitPDFSDK.FPDFPageObj_GetType(pageObject))
+                {
+                    case PageObjectType.FPDF_PAGEOBJ_IMAGE:
+                        if (image != IntPtr.Zero)
+                        {
+                            return IntPtr.Zero;
+                        }
+                        image = pageObject;
+                        break;
+                    case PageObjectType.FPDF_PAGEOBJ_TEXT:
+                        if (FoxitPDFSDK.FPDFTextObj_GetTextMode(pageObject) != invisibleTextMode)
+                        {
+                            return IntPtr.Zero;
+                        }
+                        break;
+                    default:
+                        return IntPtr.Zero;
+                }
+            }
+
+            double a, b, c, d, e, f;
+            if (image == IntPtr.Zero || FoxitPDFSDK.FPDFImageObj_GetMatrix(image, out a, out b, out c, out d, out e, out f) == 0)
+            {
+                return IntPtr.Zero;
+            }
+
+            double tolerance = width * scanTolerance;
+            bool coversPage = b == 0 && c == 0
+                && Math.Abs(e) <= tolerance && Math.Abs(f) <= tolerance
+                && Math.Abs(a - width) <= tolerance && Math.Abs(d - height) <= tolerance;
+            return coversPage ? image : IntPtr.Zero;
+        }
+
+        /// <summary>
+        /// Pull the text of a page into pageText with one pass over the text page.
+        /// Unicode values come in one call for the whole page, boxes, sizes and
+        /// fonts are read only for characters of the PDF, not generated ones.
+        /// </summary>
+        public void ExtractText(int pageIndex, PageText pageText)
+        {
+            IntPtr page = FoxitPDFSDK.FPDF_LoadPage(document, pageIndex);
+            IntPtr textPage = FoxitPDFSDK.FPDFText_LoadPage(page);
+            try
+            {
+                double width = FoxitPDFSDK.FPDF_GetPageWidth(page);
+                double height = FoxitPDFSDK.FPDF_GetPageHeight(page);
+                int widthPixels = 800;
+                int heightPixels = (int)(widthPixels * height / width);
+
+                int charCount = textPage != IntPtr.Zero ? FoxitPDFSDK.FPDFText_CountChars(textPage) : 0;
+                pageText.Reset(pageIndex, width, height, charCount);
+                AddImageBoxes(page, widthPixels, heightPixels, pageText.Images);
+                if (textPage == IntPtr.Zero)
+                {
+                    return;
+                }
+
+                if (textBuffer.Length < charCount + 1)
+                {
+                    textBuffer = new ushort[Math.Max(charCount + 1, textBuffer.Length * 2)];
+                }
+
+                // GetText skips characters without a unicode value, then the
+                // indexes do not match and each character is asked for.
+                bool bulkText = FoxitPDFSDK.FPDFText_GetText(textPage, 0, charCount, textBuffer) == charCount;
+
+                fontIds.Clear();
+                for (int index = 0; index < charCount; ++index)
+                {
+                    uint unicode = bulkText ? textBuffer[index] : FoxitPDFSDK.FPDFText_GetUnicode(textPage, index);
+                    char textChar = unicode <= 0xFFFF ? (char)unicode : '\0';
+                    pageText.Unicode[index] = textChar;
+
+                    // Only spaces and line breaks are generated.
+                    bool isGenerated = char.IsWhiteSpace(textChar) && FoxitPDFSDK.FPDFText_IsGenerated(textPage, index) != 0;
+                    pageText.IsGenerated[index] = isGenerated;
+                    if (isGenerated)
+                    {
+                        pageText.FontSize[index] = 0;
+                        pageText.FontId[index] = -1;
+                        pageText.Left[index] = pageText.Top[index] = pageText.Right[index] = pageText.Bottom[index] = 0;
+                        continue;
+                    }
+
+                    double left, right, bottom, top;
+                    FoxitPDFSDK.FPDFText_GetCharBox(textPage, index, out left, out right, out bottom, out top);
+                    pageText.Left[index] = (float)left;
+                    pageText.Top[index] = (float)top;
+                    pageText.Right[index] = (float)right;
+                    pageText.Bottom[index] = (float)bottom;
+                    pageText.FontSize[index] = (float)FoxitPDFSDK.FPDFText_GetFontSize(textPage, index);
+
+                    IntPtr font = FoxitPDFSDK.FPDFText_GetFont(textPage, index);
+                    int fontId;
+                    if (!fontIds.TryGetValue(font, out fontId))
+                    {
+                        fontId = fontIds.Count;
+                        fontIds[font] = fontId;
+                    }
+                    pageText.FontId[index] = fontId;
+                }
+                pageText.FontCount = fontIds.Count;
+
+                int rectCount = FoxitPDFSDK.FPDFText_CountRects(textPage, 0, charCount);
+                for (int rectIndex = 0; rectIndex < rectCount; ++rectIndex)
+                {
+                    double left, top, right, bottom;
+                    FoxitPDFSDK.FPDFText_GetRect(textPage, rectIndex, out left, out top, out right, out bottom);
+
+                    pageText.Lines.Add(PageToDevice(page, widthPixels, heightPixels, left, top, right, bottom));
+                }
+            }
+            finally
+            {
+                if (textPage != IntPtr.Zero)
+                {
+                    FoxitPDFSDK.FPDFText_ClosePage(textPage);
+                }
+                FoxitPDFSDK.FPDF_ClosePage(page);
+            }
+        }
+
+        /// <summary>
+        /// The boxes of the image objects of a page, from the unit square each
+        /// image matrix maps onto the page.
+        /// </summary>
+        static void AddImageBoxes(IntPtr page, int widthPixels, int heightPixels, List<Rectangle> images)
+        {
+            int objectCount = FoxitPDFSDK.FPDFPage_CountObject(page);
+            for (int index = 0; index < objectCount; ++index)
+            {
+                IntPtr pageObject = FoxitPDFSDK.FPDFPage_GetObject(page, index);
+                double a, b, c, d, e, f;
+                if (FoxitPDFSDK.FPDFPageObj_GetType(pageObject) != PageObjectType.FPDF_PAGEOBJ_IMAGE
+                    || FoxitPDFSDK.FPDFImageObj_GetMatrix(pageObject, out a, out b, out c, out d, out e, out f) == 0)
+                {
+                    continue;
+                }
+
+                double left = e + Math.Min(0, a) + Math.Min(0, c);
+                double right = e + Math.Max(0, a) + Math.Max(0, c);
+                double bottom = f + Math.Min(0, b) + Math.Min(0, d);
+                double top = f + Math.Max(0, b) + Math.Max(0, d);
+                images.Add(PageToDevice(page, widthPixels, heightPixels, left, top, right, bottom));
+            }
+        }
+
+        /// <summary>
+        /// A box in PDF user space to pixels of the page rendered by RenderPage.
+        /// </summary>
+        static Rectangle PageToDevice(IntPtr page, int widthPixels, int heightPixels, double left, double top, double right, double bottom)
+        {
+            int deviceLeft, deviceTop, deviceRight, deviceBottom;
+            FoxitPDFSDK.FPDF_PageToDevice(page, 0, 0, widthPixels, heightPixels, 0, left, top, out deviceLeft, out deviceTop);
+            FoxitPDFSDK.FPDF_PageToDevice(page, 0, 0, widthPixels, heightPixels, 0, right, bottom, out deviceRight, out deviceBottom);
+
+            return Rectangle.FromLTRB(
+                Math.Min(deviceLeft, deviceRight),
+                Math.Min(deviceTop, deviceBottom),
+                Math.Max(deviceLeft, deviceRight),
+                Math.Max(deviceTop, deviceBottom));
+        }
+
+        /// <summary>
+        /// Link annotations and web addresses found in the text of a page.
+        /// </summary>
+        public List<PageLink> GetLinks(int pageIndex)
+        {
+            List<PageLink> links = new List<PageLink>();
+
+            IntPtr page = FoxitPDFSDK.FPDF_LoadPage(document, pageIndex);
+            IntPtr textPage = FoxitPDFSDK.FPDFText_LoadPage(page);
+            try
+            {
+                int widthPixels = 800;
+                int heightPixels = (int)(widthPixels * FoxitPDFSDK.FPDF_GetPageHeight(page) / FoxitPDFSDK.FPDF_GetPageWidth(page));
+
+                int linkCount = FoxitPDFSDK.FPDFLinkObj_CountLink(page);
+                for (int linkIndex = 0; linkIndex < linkCount; ++linkIndex)
+                {
+                    IntPtr link = FoxitPDFSDK.FPDFLinkObj_GetLink(page, linkIndex);
+                    IntPtr dest = FoxitPDFSDK.FPDFLink_GetDest(document, link);
+                    if (dest == IntPtr.Zero)
+                    {
+                        IntPtr action = FoxitPDFSDK.FPDFLink_GetAction(link);
+                        if (action != IntPtr.Zero)
+                        {
+                            dest = FoxitPDFSDK.FPDFAction_GetDest(document, action);
+                        }
+                    }
+
+                    int targetPage, targetY;
+                    if (!GetDestination(dest, out targetPage, out targetY))
+                    {
+                        continue;
+                    }
+
+                    double left, top, right, bottom;
+                    FoxitPDFSDK.FPDFLinkObj_GetRect(link, out left, out top, out right, out bottom);
+                    links.Add(new PageLink()
+                    {
+                        Box = PageToDevice(page, widthPixels, heightPixels, left, top, right, bottom),
+                        TargetPage = targetPage,
+                        TargetY = targetY
+                    });
+                }
+
+                if (textPage != IntPtr.Zero)
+                {
+                    IntPtr linkPage = FoxitPDFSDK.FPDFLink_LoadWebLinks(textPage);
+                    if (linkPage != IntPtr.Zero)
+                    {
+                        int webLinkCount = FoxitPDFSDK.FPDFLink_CountWebLinks(linkPage);
+                        for (int linkIndex = 0; linkIndex < webLinkCount; ++linkIndex)
+                        {
+                            int urlLength = FoxitPDFSDK.FPDFLink_GetURL(linkPage, linkIndex, null, 0);
+                            ushort[] buffer = new ushort[urlLength + 1];
+                            FoxitPDFSDK.FPDFLink_GetURL(linkPage, linkIndex, buffer, urlLength);
+                            string url = new string(buffer.Take(urlLength).Select(c => (char)c).ToArray());
+
+                            // A web link broken over lines has a box on each line.
+                            int rectCount = FoxitPDFSDK.FPDFLink_CountRects(linkPage, linkIndex);
+                            for (int rectIndex = 0; rectIndex < rectCount; ++rectIndex)
+                            {
+                                double left, top, right, bottom;
+                                FoxitPDFSDK.FPDFLink_GetRect(linkPage, linkIndex, rectIndex, out left, out top, out right, out bottom);
+                                links.Add(new PageLink()
+                                {
+                                    Box = PageToDevice(page, widthPixels, heightPixels, left, top, right, bottom),
+                                    TargetPage = -1,
+                                    Url = url
+                                });
+                            }
+                        }
+                        FoxitPDFSDK.FPDFLink_CloseWebLinks(linkPage);
+                    }
+                }
+
+                return links;
+            }
+            finally
+            {
+                if (textPage != IntPtr.Zero)
+                {
+                    FoxitPDFSDK.FPDFText_ClosePage(textPage);
+                }
+                FoxitPDFSDK.FPDF_ClosePage(page);
+            }
+        }
+
+        /// <summary>
+        /// The outline in reading order, children after their parent.
+        /// </summary>
+        public List<Bookmark> GetBookmarks()
+        {
+            List<Bookmark> bookmarks = new List<Bookmark>();
+            AddBookmarks(bookmarks, IntPtr.Zero, 0);
+            return bookmarks;
+        }
+
+        void AddBookmarks(List<Bookmark> bookmarks, IntPtr parent, int level)
+        {
+            IntPtr bookmark = FoxitPDFSDK.FPDFBookmark_GetFirstChild(document, parent);
+            while (bookmark != IntPtr.Zero)
+            {
+                IntPtr dest = FoxitPDFSDK.FPDFBookmark_GetDest(document, bookmark);
+                if (dest == IntPtr.Zero)
+                {
+                    // Go-to action instead of a destination.
+                    IntPtr action = FoxitPDFSDK.FPDFBookmark_GetAction(bookmark);
+                    if (action != IntPtr.Zero)
+                    {
+                        dest = FoxitPDFSDK.FPDFAction_GetDest(document, action);
+                    }
+                }
+
+                int pageIndex, y;
+                if (GetDestination(dest, out pageIndex, out y))
+                {
+                    bookmarks.Add(new Bookmark()
+                    {
+                        Level = level,
+                        Title = GetBookmarkTitle(bookmark),
+                        PageIndex = pageIndex,
+                        Y = y
+                    });
+                }
+
+                AddBookmarks(bookmarks, bookmark, level + 1);
+                bookmark = FoxitPDFSDK.FPDFBookmark_GetNextSibling(document, bookmark);
+            }
+        }
+
+        static string GetBookmarkTitle(IntPtr bookmark)
+        {
+            uint length = FoxitPDFSDK.FPDFBookmark_GetTitle(bookmark, null, 0);
+            if (length <= 2)
+            {
+                return "";
+            }
+
+            byte[] buffer = new byte[length];
+            FoxitPDFSDK.FPDFBookmark_GetTitle(bookmark, buffer, length);
+            return Encoding.Unicode.GetString(buffer, 0, (int)length - 2).Trim();
+        }
+
+        /// <summary>
+        /// Page and row in render pixels of a destination. Only XYZ and fit-width
+        /// destinations carry a row, the others point at the page top.
+        /// </summary>
+        public bool GetDestination(IntPtr dest, out int pageIndex, out int y)
+        {
+            pageIndex = 0;
+            y = 0;
+            if (dest == IntPtr.Zero)
+            {
+                return false;
+            }
+
+            pageIndex = (int)FoxitPDFSDK.FPDFDest_GetPageIndex(document, dest);
+            if (pageIndex < 0 || pageIndex >= GetPageCount())
+            {
+                return false;
+            }
+
+            double top;
+            switch (FoxitPDFSDK.FPDFDest_GetZoomMode(dest))
+            {
+                case ZoomMode.ZOOM_XYZ:
+                    top = FoxitPDFSDK.FPDFDest_GetZoomParam(dest, 1);
+                    break;
+                case ZoomMode.ZOOM_FITH:
+                case ZoomMode.ZOOM_FITBH:
+                    top = FoxitPDFSDK.FPDFDest_GetZoomParam(dest, 0);
+                    break;
+                default:
+                    return true;
+            }
+
+            IntPtr page = FoxitPDFSDK.FPDF_LoadPage(document, pageIndex);
+            try
+            {
+                double height = FoxitPDFSDK.FPDF_GetPageHeight(page);
+                double scale = 800 / FoxitPDFSDK.FPDF_GetPageWidth(page);
+                if (top > 0 && top <= height)
+                {
+                    y = (int)((height - top) * scale);
+                }
+            }
+            finally
+            {
+                FoxitPDFSDK.FPDF_ClosePage(page);
+            }
+
+            return true;
+        }
+    }
+}
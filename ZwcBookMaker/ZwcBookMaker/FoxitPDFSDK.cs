@@ -10,6 +10,15 @@ namespace ZwcBookMaker
     {
         const string dllPath = "Lib/Foxit_PDF_SDK_DLL_3.1_Cracked/fpdfsdk.dll";
 
+        /// <summary>
+        /// The SDK is not documented as thread safe, not even on separate
+        /// documents. Pages are built on one thread with one document handle;
+        /// rendering and the render arena still take this lock, so a reader
+        /// used from another thread cannot overlap them. Rendering in parallel
+        /// would need one process per worker.
+        /// </summary>
+        public static readonly object SyncRoot = new object();
+
         public FoxitPDFSDK()
         {
             FPDF_UnlockDLL("SDKRDTEMP", "921315A06BD486EBC0792D60A826A5C4455E33A8");
@@ -33,17 +42,212 @@ namespace ZwcBookMaker
         [DllImport(dllPath)]
         public extern static IntPtr FPDF_LoadDocument(string path, string pwd);
 
+        [DllImport(dllPath)]
+        public extern static IntPtr FPDF_LoadCustomDocument(IntPtr fileAccess, string pwd);
+
+        [DllImport(dllPath)]
+        public extern static void FPDF_CloseDocument(IntPtr doc);
+
+        [DllImport(dllPath)]
+        public extern static uint FPDF_GetLastError();
+
+        [DllImport(dllPath)]
+        public extern static int FPDF_GetPageCount(IntPtr doc);
+
         [DllImport(dllPath)]
         public extern static IntPtr FPDF_LoadPage(IntPtr doc, int pageIndex);
 
+        [DllImport(dllPath)]
+        public extern static void FPDF_ClosePage(IntPtr page);
+
         [DllImport(dllPath)]
         public static extern void FPDF_RenderPage(System.IntPtr hdc, IntPtr page, int start_x, int start_y, int size_x, int size_y, int rotate, PageRenderingFlags flags);
 
+        [DllImport(dllPath)]
+        public static extern void FPDF_RenderPageBitmap(IntPtr bitmap, IntPtr page, int start_x, int start_y, int size_x, int size_y, int rotate, PageRenderingFlags flags);
+
+        [DllImport(dllPath)]
+        public extern static IntPtr FPDFBitmap_CreateEx(int width, int height, BitmapFormat format, IntPtr firstScan, int stride);
+
+        [DllImport(dllPath)]
+        public extern static void FPDFBitmap_FillRect(IntPtr bitmap, int left, int top, int width, int height, int red, int green, int blue, int alpha);
+
+        [DllImport(dllPath)]
+        public extern static void FPDFBitmap_Destroy(IntPtr bitmap);
+
+        [DllImport(dllPath)]
+        public extern static IntPtr FPDFBitmap_GetBuffer(IntPtr bitmap);
+
+        [DllImport(dllPath)]
+        public extern static int FPDFBitmap_GetWidth(IntPtr bitmap);
+
+        [DllImport(dllPath)]
+        public extern static int FPDFBitmap_GetHeight(IntPtr bitmap);
+
+        [DllImport(dllPath)]
+        public extern static int FPDFBitmap_GetStride(IntPtr bitmap);
+
+        [DllImport(dllPath)]
+        public extern static IntPtr FPDF_AllocMemory(uint size);
+
+        [DllImport(dllPath)]
+        public extern static void FPDF_FreeMemory(IntPtr p);
+
+        [DllImport(dllPath)]
+        public extern static void FPDF_SetErrorHandler(FPDF_ErrorHandler handler);
+
+        [DllImport(dllPath)]
+        public extern static int FSDK_SetOOMHandler(IntPtr oomInfo);
+
         [DllImport(dllPath)]
         public extern static double FPDF_GetPageWidth(IntPtr page);
 
         [DllImport(dllPath)]
         public extern static double FPDF_GetPageHeight(IntPtr page);
+
+        [DllImport(dllPath)]
+        public extern static IntPtr FPDFText_LoadPage(IntPtr page);
+
+        [DllImport(dllPath)]
+        public extern static void FPDFText_ClosePage(IntPtr textPage);
+
+        [DllImport(dllPath)]
+        public extern static int FPDFText_CountChars(IntPtr textPage);
+
+        [DllImport(dllPath)]
+        public extern static uint FPDFText_GetUnicode(IntPtr textPage, int index);
+
+        [DllImport(dllPath)]
+        public extern static int FPDFText_IsGenerated(IntPtr textPage, int index);
+
+        [DllImport(dllPath)]
+        public extern static double FPDFText_GetFontSize(IntPtr textPage, int index);
+
+        [DllImport(dllPath)]
+        public extern static IntPtr FPDFText_GetFont(IntPtr textPage, int index);
+
+        [DllImport(dllPath)]
+        public extern static void FPDFText_GetCharBox(IntPtr textPage, int index, out double left, out double right, out double bottom, out double top);
+
+        [DllImport(dllPath)]
+        public extern static int FPDFText_GetText(IntPtr textPage, int startIndex, int count, [Out] ushort[] result);
+
+        [DllImport(dllPath)]
+        public extern static int FPDFText_CountRects(IntPtr textPage, int startIndex, int count);
+
+        [DllImport(dllPath)]
+        public extern static void FPDFText_GetRect(IntPtr textPage, int rectIndex, out double left, out double top, out double right, out double bottom);
+
+        [DllImport(dllPath)]
+        public extern static void FPDF_PageToDevice(IntPtr page, int startX, int startY, int sizeX, int sizeY, int rotate, double pageX, double pageY, out int deviceX, out int deviceY);
+
+        [DllImport(dllPath)]
+        public extern static int FPDFPage_CountObject(IntPtr page);
+
+        [DllImport(dllPath)]
+        public extern static IntPtr FPDFPage_GetObject(IntPtr page, int index);
+
+        [DllImport(dllPath)]
+        public extern static PageObjectType FPDFPageObj_GetType(IntPtr pageObject);
+
+        [DllImport(dllPath)]
+        public extern static int FPDFTextObj_GetTextMode(IntPtr textObject);
+
+        /// <summary>
+        /// Image space, the unit square, to page space.
+        /// </summary>
+        [DllImport(dllPath)]
+        public extern static int FPDFImageObj_GetMatrix(IntPtr imageObject, out double a, out double b, out double c, out double d, out double e, out double f);
+
+        /// <summary>
+        /// The decoded pixels of an image, a new bitmap the caller destroys.
+        /// </summary>
+        [DllImport(dllPath)]
+        public extern static IntPtr FPDFImageObj_GetBitmap(IntPtr imageObject);
+
+        [DllImport(dllPath)]
+        public extern static IntPtr FPDFAvail_Create(IntPtr fileAvail, IntPtr fileAccess);
+
+        [DllImport(dllPath)]
+        public extern static void FPDFAvail_Destroy(IntPtr avail);
+
+        [DllImport(dllPath)]
+        public extern static int FPDFAvail_IsDocAvail(IntPtr avail, IntPtr hints);
+
+        [DllImport(dllPath)]
+        public extern static IntPtr FPDFAvail_GetDocument(IntPtr avail);
+
+        [DllImport(dllPath)]
+        public extern static int FPDFAvail_GetFirstPageNum(IntPtr doc);
+
+        [DllImport(dllPath)]
+        public extern static int FPDFAvail_IsPageAvail(IntPtr avail, int pageIndex, IntPtr hints);
+
+        [DllImport(dllPath)]
+        public extern static int FPDFAvail_IsLinearized(IntPtr avail);
+
+        [DllImport(dllPath)]
+        public extern static IntPtr FPDFBookmark_GetFirstChild(IntPtr document, IntPtr bookmark);
+
+        [DllImport(dllPath)]
+        public extern static IntPtr FPDFBookmark_GetNextSibling(IntPtr document, IntPtr bookmark);
+
+        /// <summary>
+        /// Title as UTF-16LE, returns the number of bytes including the terminator.
+        /// </summary>
+        [DllImport(dllPath)]
+        public extern static uint FPDFBookmark_GetTitle(IntPtr bookmark, [Out] byte[] buffer, uint bufferLength);
+
+        [DllImport(dllPath)]
+        public extern static IntPtr FPDFBookmark_GetDest(IntPtr document, IntPtr bookmark);
+
+        [DllImport(dllPath)]
+        public extern static IntPtr FPDFBookmark_GetAction(IntPtr bookmark);
+
+        [DllImport(dllPath)]
+        public extern static IntPtr FPDFAction_GetDest(IntPtr document, IntPtr action);
+
+        [DllImport(dllPath)]
+        public extern static uint FPDFDest_GetPageIndex(IntPtr document, IntPtr dest);
+
+        [DllImport(dllPath)]
+        public extern static ZoomMode FPDFDest_GetZoomMode(IntPtr dest);
+
+        [DllImport(dllPath)]
+        public extern static double FPDFDest_GetZoomParam(IntPtr dest, int param);
+
+        [DllImport(dllPath)]
+        public extern static int FPDFLinkObj_CountLink(IntPtr page);
+
+        [DllImport(dllPath)]
+        public extern static IntPtr FPDFLinkObj_GetLink(IntPtr page, int index);
+
+        [DllImport(dllPath)]
+        public extern static void FPDFLinkObj_GetRect(IntPtr link, out double left, out double top, out double right, out double bottom);
+
+        [DllImport(dllPath)]
+        public extern static IntPtr FPDFLink_GetDest(IntPtr document, IntPtr link);
+
+        [DllImport(dllPath)]
+        public extern static IntPtr FPDFLink_GetAction(IntPtr link);
+
+        [DllImport(dllPath)]
+        public extern static IntPtr FPDFLink_LoadWebLinks(IntPtr textPage);
+
+        [DllImport(dllPath)]
+        public extern static int FPDFLink_CountWebLinks(IntPtr linkPage);
+
+        [DllImport(dllPath)]
+        public extern static int FPDFLink_GetURL(IntPtr linkPage, int linkIndex, [Out] ushort[] buffer, int bufferLength);
+
+        [DllImport(dllPath)]
+        public extern static int FPDFLink_CountRects(IntPtr linkPage, int linkIndex);
+
+        [DllImport(dllPath)]
+        public extern static void FPDFLink_GetRect(IntPtr linkPage, int linkIndex, int rectIndex, out double left, out double top, out double right, out double bottom);
+
+        [DllImport(dllPath)]
+        public extern static void FPDFLink_CloseWebLinks(IntPtr linkPage);
     }
 
     public enum PageRenderingFlags
@@ -55,4 +259,88 @@ namespace ZwcBookMaker
         FPDF_DEBUG_INFO = 128,
         FPDF_NO_CATCH = 256,
     }
+
+    public enum ErrorCode
+    {
+        FPDFERR_OUT_OF_MEMORY = 1,
+        FPDFERR_MISSING_FEATURE = 2,
+    }
+
+    public enum ZoomMode
+    {
+        ZOOM_XYZ = 1,
+        ZOOM_FIT = 2,
+        ZOOM_FITH = 3,
+        ZOOM_FITV = 4,
+        ZOOM_FITR = 5,
+        ZOOM_FITB = 6,
+        ZOOM_FITBH = 7,
+        ZOOM_FITBV = 8,
+    }
+
+    public enum PageObjectType
+    {
+        FPDF_PAGEOBJ_TEXT = 1,
+        FPDF_PAGEOBJ_PATH = 2,
+        FPDF_PAGEOBJ_IMAGE = 3,
+        FPDF_PAGEOBJ_SHADING = 4,
+        FPDF_PAGEOBJ_FORM = 5,
+    }
+
+    public enum BitmapFormat
+    {
+        FPDFBitmap_Gray = 1,
+        FPDFBitmap_BGR = 2,
+        FPDFBitmap_BGRx = 3,
+        FPDFBitmap_BGRA = 4,
+    }
+
+    /// <summary>
+    /// FPDF_FILEACCESS, the SDK keeps the pointer until the document is closed,
+    /// so it must live in unmanaged memory.
+    /// </summary>
+    [StructLayout(LayoutKind.Sequential)]
+    public struct FPDF_FILEACCESS
+    {
+        public uint m_FileLen;
+        public IntPtr m_GetBlock;
+        public IntPtr m_Param;
+    }
+
+    [UnmanagedFunctionPointer(CallingConvention.Cdecl)]
+    public delegate int FPDF_GetBlock(IntPtr param, uint position, IntPtr buffer, uint size);
+
+    [UnmanagedFunctionPointer(CallingConvention.Cdecl, CharSet = CharSet.Ansi)]
+    public delegate void FPDF_ErrorHandler(ErrorCode code, string message);
+
+    [StructLayout(LayoutKind.Sequential)]
+    public struct OOM_INFO
+    {
+        public int version;
+        public IntPtr FSDK_OOM_Handler;
+    }
+
+    [UnmanagedFunctionPointer(CallingConvention.Cdecl)]
+    public delegate void FSDK_OOM_Handler(IntPtr pThis);
+
+    [StructLayout(LayoutKind.Sequential)]
+    public struct FX_FILEAVAIL
+    {
+        public int version;
+        public IntPtr IsDataAvail;
+    }
+
+    [UnmanagedFunctionPointer(CallingConvention.Cdecl)]
+    [return: MarshalAs(UnmanagedType.I1)]
+    public delegate bool FX_IsDataAvail(IntPtr pThis, UIntPtr offset, UIntPtr size);
+
+    [StructLayout(LayoutKind.Sequential)]
+    public struct FX_DOWNLOADHINTS
+    {
+        public int version;
+        public IntPtr AddSegment;
+    }
+
+    [UnmanagedFunctionPointer(CallingConvention.Cdecl)]
+    public delegate void FX_AddSegment(IntPtr pThis, UIntPtr offset, UIntPtr size);
 }
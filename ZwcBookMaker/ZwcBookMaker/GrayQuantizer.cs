@@ -0,0 +1,348 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Linq;
+using System.Text;
+using System.Diagnostics;
+using System.Drawing;
+using System.Drawing.Imaging;
+
+namespace ZwcBookMaker
+{
+    public enum DitherMode
+    {
+        // Error diffusion for pictures, ordered dithering for text.
+        Auto,
+        None,
+        Ordered,
+        FloydSteinberg
+    }
+
+    /// <summary>
+    /// Turns pages into the 16 gray levels of the e-ink panel, two pixels per
+    /// byte in a 4 bit indexed bitmap. The GIF encoder writes such a bitmap
+    /// with its own palette instead of building one from the colors.
+    /// </summary>
+    public class GrayQuantizer
+    {
+        public const int LevelCount = 16;
+        public const int LevelStep = 255 / (LevelCount - 1);
+
+        // Pages with more pixels than this between near white and near black
+        // are pictures, where error diffusion hides the banding.
+        const double pictureShare = 0.15;
+
+        // Side of the tiles the rotation works in, 16 rows of 16 pixels stay in
+        // the cache while they are written to 16 rows of the target.
+        const int rotateTile = 16;
+
+        static readonly int[] bayer4x4 = { 0, 8, 2, 10, 12, 4, 14, 6, 3, 11, 1, 9, 15, 7, 13, 5 };
+
+        // Level of each gray value, rounded and under each of the 16 Bayer thresholds.
+        static readonly byte[] nearestLevels = BuildLevels(0.5);
+        static readonly byte[][] orderedLevels = bayer4x4.Select(threshold => BuildLevels((threshold + 0.5) / 16)).ToArray();
+
+        // Reused from page to page.
+        byte[] gray = new byte[0];
+        int[] currentErrors = new int[0];
+        int[] nextErrors = new int[0];
+
+        int orderedPageCount = 0;
+        int diffusedPageCount = 0;
+        int plainPageCount = 0;
+        long pixelCount = 0;
+        TimeSpan quantizeTime = TimeSpan.Zero;
+
+        /// <summary>
+        /// Level of each gray value, rounded up from the given fraction of a step.
+        /// </summary>
+        static byte[] BuildLevels(double threshold)
+        {
+            byte[] levels = new byte[256];
+            for (int value = 0; value < 256; ++value)
+            {
+                int level = (int)((double)value / LevelStep + threshold);
+                levels[value] = (byte)Math.Min(level, LevelCount - 1);
+            }
+            return levels;
+        }
+
+        /// <summary>
+        /// A 4 bit gray copy of a 32 bit page. With rotate the copy is turned 90
+        /// degrees clockwise on the way, the rotated 32 bit page is never made.
+        /// </summary>
+        public Bitmap Quantize(Bitmap page, DitherMode mode = DitherMode.Auto, bool rotate = false)
+        {
+            var stopwatch = Stopwatch.StartNew();
+
+            int width = rotate ? page.Height : page.Width;
+            int height = rotate ? page.Width : page.Height;
+            int midTones = rotate ? ToGrayRotated(page) : ToGray(page);
+            if (mode == DitherMode.Auto)
+            {
+                mode = midTones > width * height * pictureShare ? DitherMode.FloydSteinberg : DitherMode.Ordered;
+            }
+
+            Bitmap result = new Bitmap(width, height, PixelFormat.Format4bppIndexed);
+            ColorPalette palette = result.Palette;
+            for (int level = 0; level < LevelCount; ++level)
+            {
+                palette.Entries[level] = Color.FromArgb(level * LevelStep, level * LevelStep, level * LevelStep);
+            }
+            result.Palette = palette;
+
+            BitmapData data = result.LockBits(new Rectangle(0, 0, width, height), ImageLockMode.WriteOnly, PixelFormat.Format4bppIndexed);
+            try
+            {
+                switch (mode)
+                {
+                    case DitherMode.FloydSteinberg:
+                        QuantizeFloydSteinberg(data);
+                        ++diffusedPageCount;
+                        break;
+                    case DitherMode.Ordered:
+                        QuantizeOrdered(data);
+                        ++orderedPageCount;
+                        break;
+                    default:
+                        QuantizeNearest(data);
+                        ++plainPageCount;
+                        break;
+                }
+            }
+            finally
+            {
+                result.UnlockBits(data);
+            }
+
+            pixelCount += (long)width * height;
+            quantizeTime += stopwatch.Elapsed;
+            return result;
+        }
+
+        /// <summary>
+        /// Fill the gray buffer, returns the number of mid tone pixels.
+        /// </summary>
+        unsafe int ToGray(Bitmap page)
+        {
+            int width = page.Width;
+            int height = page.Height;
+            if (gray.Length < width * height)
+            {
+                gray = new byte[width * height];
+            }
+
+            int midTones = 0;
+            BitmapData data = page.LockBits(new Rectangle(0, 0, width, height), ImageLockMode.ReadOnly, PixelFormat.Format32bppArgb);
+            try
+            {
+                fixed (byte* target = gray)
+                {
+                    for (int y = 0; y < height; ++y)
+                    {
+                        byte* pixel = (byte*)data.Scan0 + (long)y * data.Stride;
+                        byte* row = target + y * width;
+                        for (int x = 0; x < width; ++x, pixel += 4)
+                        {
+                            // BT.601 luma with weights adding up to 256.
+                            int value = (pixel[2] * 77 + pixel[1] * 150 + pixel[0] * 29 + 128) >> 8;
+                            row[x] = (byte)value;
+                            if ((uint)(value - 32) < 192)
+                            {
+                                ++midTones;
+                            }
+                        }
+                    }
+                }
+            }
+            finally
+            {
+                page.UnlockBits(data);
+            }
+
+            return midTones;
+        }
+
+        /// <summary>
+        /// Fill the gray buffer with the page turned 90 degrees clockwise: source
+        /// row y becomes target column height - 1 - y. The page is walked in
+        /// square tiles so reads and writes both stay within a few cache lines.
+        /// </summary>
+        unsafe int ToGrayRotated(Bitmap page)
+        {
+            int width = page.Width;
+            int height = page.Height;
+            if (gray.Length < width * height)
+            {
+                gray = new byte[width * height];
+            }
+
+            // Rows of the target are as long as the source is high.
+            int targetWidth = height;
+            int midTones = 0;
+            BitmapData data = page.LockBits(new Rectangle(0, 0, width, height), ImageLockMode.ReadOnly, PixelFormat.Format32bppArgb);
+            try
+            {
+                fixed (byte* target = gray)
+                {
+                    for (int tileY = 0; tileY < height; tileY += rotateTile)
+                    {
+                        int tileBottom = Math.Min(tileY + rotateTile, height);
+                        for (int tileX = 0; tileX < width; tileX += rotateTile)
+                        {
+                            int tileRight = Math.Min(tileX + rotateTile, width);
+                            for (int y = tileY; y < tileBottom; ++y)
+                            {
+                                byte* pixel = (byte*)data.Scan0 + (long)y * data.Stride + tileX * 4;
+                                byte* column = target + (long)tileX * targetWidth + (height - 1 - y);
+                                for (int x = tileX; x < tileRight; ++x, pixel += 4, column += targetWidth)
+                                {
+                                    int value = (pixel[2] * 77 + pixel[1] * 150 + pixel[0] * 29 + 128) >> 8;
+                                    *column = (byte)value;
+                                    if ((uint)(value - 32) < 192)
+                                    {
+                                        ++midTones;
+                                    }
+                                }
+                            }
+                        }
+                    }
+                }
+            }
+            finally
+            {
+                page.UnlockBits(data);
+            }
+
+            return midTones;
+        }
+
+        unsafe void QuantizeNearest(BitmapData data)
+        {
+            int width = data.Width;
+            fixed (byte* source = gray)
+            fixed (byte* levels = nearestLevels)
+            {
+                for (int y = 0; y < data.Height; ++y)
+                {
+                    byte* row = source + y * width;
+                    byte* target = (byte*)data.Scan0 + (long)y * data.Stride;
+                    int x = 0;
+                    for (; x + 1 < width; x += 2)
+                    {
+                        *target++ = (byte)((levels[row[x]] << 4) | levels[row[x + 1]]);
+                    }
+                    if (x < width)
+                    {
+                        *target = (byte)(levels[row[x]] << 4);
+                    }
+                }
+            }
+        }
+
+        /// <summary>
+        /// 4x4 Bayer dithering, one table lookup per pixel.
+        /// </summary>
+        unsafe void QuantizeOrdered(BitmapData data)
+        {
+            int width = data.Width;
+            fixed (byte* source = gray)
+            {
+                for (int y = 0; y < data.Height; ++y)
+                {
+                    byte* row = source + y * width;
+                    byte* target = (byte*)data.Scan0 + (long)y * data.Stride;
+
+                    // Thresholds of this row repeat every 4 pixels, 2 bytes.
+                    int thresholdRow = (y & 3) * 4;
+                    byte[] levels0 = orderedLevels[thresholdRow];
+                    byte[] levels1 = orderedLevels[thresholdRow + 1];
+                    byte[] levels2 = orderedLevels[thresholdRow + 2];
+                    byte[] levels3 = orderedLevels[thresholdRow + 3];
+
+                    int x = 0;
+                    for (; x + 3 < width; x += 4)
+                    {
+                        *target++ = (byte)((levels0[row[x]] << 4) | levels1[row[x + 1]]);
+                        *target++ = (byte)((levels2[row[x + 2]] << 4) | levels3[row[x + 3]]);
+                    }
+                    for (; x < width; ++x)
+                    {
+                        int level = orderedLevels[thresholdRow + (x & 3)][row[x]];
+                        if ((x & 1) == 0)
+                        {
+                            *target = (byte)(level << 4);
+                        }
+                        else
+                        {
+                            *target++ |= (byte)level;
+                        }
+                    }
+                }
+            }
+        }
+
+        /// <summary>
+        /// Floyd-Steinberg error diffusion, errors kept in 16ths of a gray value.
+        /// </summary>
+        unsafe void QuantizeFloydSteinberg(BitmapData data)
+        {
+            int width = data.Width;
+            if (currentErrors.Length < width + 2)
+            {
+                currentErrors = new int[width + 2];
+                nextErrors = new int[width + 2];
+            }
+            Array.Clear(currentErrors, 0, currentErrors.Length);
+
+            fixed (byte* source = gray)
+            fixed (byte* levels = nearestLevels)
+            {
+                for (int y = 0; y < data.Height; ++y)
+                {
+                    byte* row = source + y * width;
+                    byte* target = (byte*)data.Scan0 + (long)y * data.Stride;
+                    Array.Clear(nextErrors, 0, nextErrors.Length);
+
+                    fixed (int* current = currentErrors)
+                    fixed (int* next = nextErrors)
+                    {
+                        for (int x = 0; x < width; ++x)
+                        {
+                            int value = row[x] + ((current[x + 1] + 8) >> 4);
+                            value = value < 0 ? 0 : (value > 255 ? 255 : value);
+
+                            int level = levels[value];
+                            int error = value - level * LevelStep;
+                            current[x + 2] += error * 7;
+                            next[x] += error * 3;
+                            next[x + 1] += error * 5;
+                            next[x + 2] += error;
+
+                            if ((x & 1) == 0)
+                            {
+                                *target = (byte)(level << 4);
+                            }
+                            else
+                            {
+                                *target++ |= (byte)level;
+                            }
+                        }
+                    }
+
+                    int[] swap = currentErrors;
+                    currentErrors = nextErrors;
+                    nextErrors = swap;
+                }
+            }
+        }
+
+        public string GetStatistics()
+        {
+            return string.Format("Quantized {0} pages ordered, {1} diffused, {2} plain, {3:F0} Mpixel/s",
+                orderedPageCount,
+                diffusedPageCount,
+                plainPageCount,
+                quantizeTime.TotalSeconds > 0 ? pixelCount / quantizeTime.TotalSeconds / 1e6 : 0);
+        }
+    }
+}
@@ -0,0 +1,104 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Linq;
+using System.Text;
+using System.Diagnostics;
+using System.Drawing;
+using System.Drawing.Imaging;
+using System.IO;
+using System.Windows.Forms;
+
+namespace ZwcBookMaker
+{
+    public class GrayQuantizerTest
+    {
+        const int repeatCount = 20;
+
+        public void Run()
+        {
+            string path = Path.Combine(Application.StartupPath, "人月神话.pdf");
+
+            using (var foxitPdf = new FoxitPDFSDK())
+            using (var pdfSource = new MappedPDFSource(path))
+            using (var reader = new FoxitPDFReader(pdfSource))
+            using (Bitmap rendered = reader.RenderPage(0))
+            using (Bitmap page = new Bitmap(rendered))
+            {
+                StringBuilder report = new StringBuilder();
+                report.AppendFormat("{0}x{1} page, {2} runs\n", page.Width, page.Height, repeatCount);
+
+                // What SaveImage did before, GDI+ builds the GIF palette.
+                var gdiTime = Stopwatch.StartNew();
+                byte[] gif = null;
+                for (int run = 0; run < repeatCount; ++run)
+                {
+                    using (MemoryStream stream = new MemoryStream())
+                    {
+                        page.Save(stream, ImageFormat.Gif);
+                        gif = stream.ToArray();
+                    }
+                }
+                gdiTime.Stop();
+                using (Bitmap decoded = new Bitmap(new MemoryStream(gif)))
+                {
+                    report.AppendFormat("GDI+ GIF: {0:F1} Mpixel/s, PSNR {1:F1} dB\n",
+                        MegapixelsPerSecond(page, gdiTime),
+                        GetPsnr(page, decoded));
+                }
+
+                GrayQuantizer quantizer = new GrayQuantizer();
+                foreach (DitherMode mode in new DitherMode[] { DitherMode.None, DitherMode.Ordered, DitherMode.FloydSteinberg })
+                {
+                    Bitmap quantized = null;
+                    var time = Stopwatch.StartNew();
+                    for (int run = 0; run < repeatCount; ++run)
+                    {
+                        if (quantized != null)
+                        {
+                            quantized.Dispose();
+                        }
+                        quantized = quantizer.Quantize(page, mode);
+                    }
+                    time.Stop();
+
+                    report.AppendFormat("{0}: {1:F1} Mpixel/s, PSNR {2:F1} dB\n",
+                        mode,
+                        MegapixelsPerSecond(page, time),
+                        GetPsnr(page, quantized));
+                    quantized.Dispose();
+                }
+
+                MessageBox.Show(report.ToString());
+            }
+        }
+
+        static double MegapixelsPerSecond(Bitmap page, Stopwatch time)
+        {
+            return (double)page.Width * page.Height * repeatCount / time.Elapsed.TotalSeconds / 1e6;
+        }
+
+        /// <summary>
+        /// PSNR of the gray of an image against the gray of the source page.
+        /// </summary>
+        static double GetPsnr(Bitmap source, Bitmap image)
+        {
+            double squaredError = 0;
+            for (int y = 0; y < source.Height; ++y)
+            {
+                for (int x = 0; x < source.Width; ++x)
+                {
+                    double difference = Gray(source.GetPixel(x, y)) - Gray(image.GetPixel(x, y));
+                    squaredError += difference * difference;
+                }
+            }
+
+            double meanSquaredError = squaredError / (source.Width * source.Height);
+            return meanSquaredError > 0 ? 10 * Math.Log10(255.0 * 255.0 / meanSquaredError) : double.PositiveInfinity;
+        }
+
+        static double Gray(Color color)
+        {
+            return 0.299 * color.R + 0.587 * color.G + 0.114 * color.B;
+        }
+    }
+}
@@ -0,0 +1,27 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Linq;
+using System.Text;
+
+namespace ZwcBookMaker
+{
+    /// <summary>
+    /// Extra data stored in the book package next to the pages. Source pages
+    /// are passed in after they are added to the PageOutPutter, Build is called
+    /// after Flush when every output page is known.
+    /// </summary>
+    public interface IPackageSection
+    {
+        /// <summary>
+        /// Four ASCII characters naming the section in the package directory.
+        /// </summary>
+        string Tag { get; }
+
+        /// <summary>
+        /// pageText is reused for the next page, keep a copy of what is needed.
+        /// </summary>
+        void AddSourcePage(FoxitPDFReader textReader, PageText pageText);
+
+        byte[] Build(FoxitPDFReader textReader, PageOutPutter outPutter);
+    }
+}
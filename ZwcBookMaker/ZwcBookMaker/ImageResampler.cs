@@ -0,0 +1,86 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Linq;
+using System.Text;
+
+namespace ZwcBookMaker
+{
+    /// <summary>
+    /// Scales the pixels of a scanned page to the page size. Each target pixel
+    /// is the average of the source pixels under it, a box filter that reads
+    /// every source pixel once. Scans are nearly always larger than the page,
+    /// when one is smaller the nearest pixel is taken.
+    /// </summary>
+    public static class ImageResampler
+    {
+        /// <summary>
+        /// Source pixels of 3 (BGR) or 4 (BGRx) bytes to a 32 bit target.
+        /// </summary>
+        public static unsafe void Resample(IntPtr source, int sourceWidth, int sourceHeight, int sourceStride, int bytesPerPixel,
+            IntPtr target, int targetStride, int width, int height)
+        {
+            int[] columnStarts, columnEnds, rowStarts, rowEnds;
+            GetSpans(sourceWidth, width, out columnStarts, out columnEnds);
+            GetSpans(sourceHeight, height, out rowStarts, out rowEnds);
+
+            // Sums of blue, green and red of each target pixel of the row.
+            int[] sums = new int[width * 3];
+
+            fixed (int* sum = sums)
+            fixed (int* starts = columnStarts)
+            fixed (int* ends = columnEnds)
+            {
+                for (int y = 0; y < height; ++y)
+                {
+                    Array.Clear(sums, 0, sums.Length);
+                    for (int sourceY = rowStarts[y]; sourceY < rowEnds[y]; ++sourceY)
+                    {
+                        byte* row = (byte*)source + (long)sourceY * sourceStride;
+                        for (int x = 0; x < width; ++x)
+                        {
+                            int blue = 0, green = 0, red = 0;
+                            byte* end = row + ends[x] * bytesPerPixel;
+                            for (byte* pixel = row + starts[x] * bytesPerPixel; pixel < end; pixel += bytesPerPixel)
+                            {
+                                blue += pixel[0];
+                                green += pixel[1];
+                                red += pixel[2];
+                            }
+                            sum[x * 3] += blue;
+                            sum[x * 3 + 1] += green;
+                            sum[x * 3 + 2] += red;
+                        }
+                    }
+
+                    int rowCount = rowEnds[y] - rowStarts[y];
+                    uint* targetRow = (uint*)((byte*)target + (long)y * targetStride);
+                    for (int x = 0; x < width; ++x)
+                    {
+                        // Division by the pixel count as a 16 bit fixed point multiply,
+                        // rounded up so that white stays 255.
+                        int count = rowCount * (ends[x] - starts[x]);
+                        int reciprocal = ((1 << 16) + count - 1) / count;
+                        uint blue = Math.Min((uint)((sum[x * 3] * reciprocal) >> 16), 255);
+                        uint green = Math.Min((uint)((sum[x * 3 + 1] * reciprocal) >> 16), 255);
+                        uint red = Math.Min((uint)((sum[x * 3 + 2] * reciprocal) >> 16), 255);
+                        targetRow[x] = 0xFF000000 | (red << 16) | (green << 8) | blue;
+                    }
+                }
+            }
+        }
+
+        /// <summary>
+        /// Source pixels [starts[i], ends[i]) under target pixel i, never empty.
+        /// </summary>
+        static void GetSpans(int sourceSize, int targetSize, out int[] starts, out int[] ends)
+        {
+            starts = new int[targetSize];
+            ends = new int[targetSize];
+            for (int index = 0; index < targetSize; ++index)
+            {
+                starts[index] = Math.Min((int)((long)index * sourceSize / targetSize), sourceSize - 1);
+                ends[index] = Math.Max(starts[index] + 1, (int)((long)(index + 1) * sourceSize / targetSize));
+            }
+        }
+    }
+}
@@ -0,0 +1,169 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Linq;
+using System.Text;
+using System.Drawing;
+using System.IO;
+
+namespace ZwcBookMaker
+{
+    /// <summary>
+    /// Links of every output page, boxes in pixels of the saved (rotated) page
+    /// image. Links are bucketed by page and sorted by top within a page, so
+    /// the reader reads one page's entries and stops at the first below the point.
+    ///
+    /// Section layout:
+    ///   int pageCount
+    ///   (pageCount + 1) x int offset of each page's links from the section start
+    ///   per page: ushort count, count x [short left][short top][ushort width][ushort height]
+    ///                                    [int target output page, 0 for web links][int url index, -1 for none]
+    ///   int urlCount, (urlCount + 1) x int char offset, URL characters UTF-16LE
+    /// </summary>
+    public class LinkTableBuilder : IPackageSection
+    {
+        public const string SectionTag = "LINK";
+
+        class OutputLink
+        {
+            public Rectangle Box;
+            public int TargetPage;
+            public int UrlIndex;
+        }
+
+        List<List<PageLink>> sourcePages = new List<List<PageLink>>();
+        int linkCount = 0;
+
+        public string Tag
+        {
+            get
+            {
+                return SectionTag;
+            }
+        }
+
+        public void AddSourcePage(FoxitPDFReader textReader, PageText pageText)
+        {
+            int sourcePageIndex = pageText.PageIndex;
+            while (sourcePages.Count <= sourcePageIndex)
+            {
+                sourcePages.Add(null);
+            }
+            sourcePages[sourcePageIndex] = textReader.GetLinks(sourcePageIndex);
+        }
+
+        public byte[] Build(FoxitPDFReader textReader, PageOutPutter outPutter)
+        {
+            int pageCount = outPutter.GetOutputPageCount();
+            List<List<OutputLink>> outputPages = new List<List<OutputLink>>();
+            for (int page = 0; page < pageCount; ++page)
+            {
+                outputPages.Add(new List<OutputLink>());
+            }
+
+            List<string> urls = new List<string>();
+            Dictionary<string, int> urlIndexes = new Dictionary<string, int>();
+
+            for (int sourcePageIndex = 0; sourcePageIndex < sourcePages.Count; ++sourcePageIndex)
+            {
+                if (sourcePages[sourcePageIndex] == null)
+                {
+                    continue;
+                }
+
+                foreach (var link in sourcePages[sourcePageIndex])
+                {
+                    int targetPage = 0;
+                    if (link.TargetPage >= 0)
+                    {
+                        if (link.TargetPage >= outPutter.GetSourcePageCount())
+                        {
+                            continue;
+                        }
+                        targetPage = outPutter.GetOutputPageIndex(link.TargetPage, 0, link.TargetY);
+                    }
+
+                    int urlIndex = -1;
+                    if (link.Url != null && !urlIndexes.TryGetValue(link.Url, out urlIndex))
+                    {
+                        urlIndex = urls.Count;
+                        urls.Add(link.Url);
+                        urlIndexes[link.Url] = urlIndex;
+                    }
+
+                    // The page the middle of the link is on, as for text.
+                    Rectangle pageBox;
+                    int page = outPutter.GetOutputPageIndex(sourcePageIndex, link.Box, out pageBox);
+                    if (page > pageCount)
+                    {
+                        continue;
+                    }
+
+                    outputPages[page - 1].Add(new OutputLink()
+                    {
+                        Box = PageOutPutter.RotateToSavedPage(pageBox),
+                        TargetPage = targetPage,
+                        UrlIndex = urlIndex
+                    });
+                    ++linkCount;
+                }
+            }
+
+            MemoryStream section = new MemoryStream();
+            using (BinaryWriter writer = new BinaryWriter(section))
+            {
+                writer.Write(pageCount);
+                int offsetTable = (int)section.Position;
+                for (int page = 0; page <= pageCount; ++page)
+                {
+                    writer.Write(0);
+                }
+
+                List<int> offsets = new List<int>();
+                foreach (var links in outputPages)
+                {
+                    offsets.Add((int)section.Position);
+
+                    var sortedLinks = links.OrderBy(link => link.Box.Top).Take(ushort.MaxValue).ToList();
+                    writer.Write((ushort)sortedLinks.Count);
+                    foreach (var link in sortedLinks)
+                    {
+                        writer.Write((short)link.Box.Left);
+                        writer.Write((short)link.Box.Top);
+                        writer.Write((ushort)link.Box.Width);
+                        writer.Write((ushort)link.Box.Height);
+                        writer.Write(link.TargetPage);
+                        writer.Write(link.UrlIndex);
+                    }
+                }
+                offsets.Add((int)section.Position);
+
+                writer.Write(urls.Count);
+                int charOffset = 0;
+                foreach (var url in urls)
+                {
+                    writer.Write(charOffset);
+                    charOffset += url.Length;
+                }
+                writer.Write(charOffset);
+                foreach (var url in urls)
+                {
+                    writer.Write(Encoding.Unicode.GetBytes(url));
+                }
+
+                section.Seek(offsetTable, SeekOrigin.Begin);
+                foreach (int offset in offsets)
+                {
+                    writer.Write(offset);
+                }
+                writer.Flush();
+
+                return section.ToArray();
+            }
+        }
+
+        public string GetStatistics()
+        {
+            return string.Format("Link table {0} links", linkCount);
+        }
+    }
+}
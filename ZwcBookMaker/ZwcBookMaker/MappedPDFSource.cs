@@ -0,0 +1,169 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Linq;
+using System.Text;
+using System.IO;
+using System.IO.MemoryMappedFiles;
+using System.Runtime.InteropServices;
+using System.Threading;
+
+namespace ZwcBookMaker
+{
+    /// <summary>
+    /// Serves FPDF_LoadCustomDocument from one read-only mapping of the PDF,
+    /// so document handles opened on it share the same page cache copy.
+    /// </summary>
+    public class MappedPDFSource : IDisposable
+    {
+        const int pageSize = 4096;
+        const int readaheadSize = 1024 * 1024;
+
+        MemoryMappedFile mappedFile = null;
+        MemoryMappedViewAccessor view = null;
+        IntPtr baseAddress;
+        long fileLength;
+
+        // Keep the callback alive, the SDK only holds the function pointer.
+        FPDF_GetBlock getBlock;
+        IntPtr fileAccess;
+
+        long lastBlockEnd = -1;
+        long readaheadEnd = 0;
+        int readaheadPending = 0;
+        // Set by Dispose, a queued readahead then stops touching the view.
+        volatile bool disposing = false;
+        object readaheadLock = new object();
+
+        long getBlockCount = 0;
+        long sequentialCount = 0;
+        long bytesServed = 0;
+        long readaheadBytes = 0;
+
+        public MappedPDFSource(string path)
+        {
+            fileLength = new FileInfo(path).Length;
+            mappedFile = MemoryMappedFile.CreateFromFile(path, FileMode.Open, null, 0, MemoryMappedFileAccess.Read);
+            view = mappedFile.CreateViewAccessor(0, 0, MemoryMappedFileAccess.Read);
+            baseAddress = view.SafeMemoryMappedViewHandle.DangerousGetHandle();
+
+            getBlock = new FPDF_GetBlock(GetBlock);
+            var access = new FPDF_FILEACCESS()
+            {
+                m_FileLen = (uint)fileLength,
+                m_GetBlock = Marshal.GetFunctionPointerForDelegate(getBlock),
+                m_Param = IntPtr.Zero
+            };
+
+            fileAccess = Marshal.AllocHGlobal(Marshal.SizeOf(typeof(FPDF_FILEACCESS)));
+            Marshal.StructureToPtr(access, fileAccess, false);
+        }
+
+        public void Dispose()
+        {
+            // Documents opened on this source must be closed before. A queued
+            // readahead may still be reading the view, wait for it to stop.
+            lock (readaheadLock)
+            {
+                disposing = true;
+                while (readaheadPending != 0)
+                {
+                    Monitor.Wait(readaheadLock);
+                }
+            }
+
+            Marshal.FreeHGlobal(fileAccess);
+            view.Dispose();
+            mappedFile.Dispose();
+        }
+
+        /// <summary>
+        /// Pointer to the FPDF_FILEACCESS for FPDF_LoadCustomDocument.
+        /// </summary>
+        public IntPtr FileAccess
+        {
+            get
+            {
+                return fileAccess;
+            }
+        }
+
+        public long Length
+        {
+            get
+            {
+                return fileLength;
+            }
+        }
+
+        int GetBlock(IntPtr param, uint position, IntPtr buffer, uint size)
+        {
+            if (position + (long)size > fileLength)
+            {
+                return 0;
+            }
+
+            WinAPI.CopyMemory(buffer, new IntPtr(baseAddress.ToInt64() + position), new UIntPtr(size));
+
+            Interlocked.Increment(ref getBlockCount);
+            Interlocked.Add(ref bytesServed, size);
+
+            long previousEnd = Interlocked.Exchange(ref lastBlockEnd, position + (long)size);
+            if (previousEnd == position)
+            {
+                Interlocked.Increment(ref sequentialCount);
+                Readahead(position + size);
+            }
+
+            return 1;
+        }
+
+        /// <summary>
+        /// Windows has no madvise, touch the pages after a sequential read in
+        /// the thread pool instead so the next blocks are already resident.
+        /// </summary>
+        void Readahead(long start)
+        {
+            long end = Math.Min(start + readaheadSize, fileLength);
+            if (disposing || end <= Interlocked.Read(ref readaheadEnd) || Interlocked.CompareExchange(ref readaheadPending, 1, 0) != 0)
+            {
+                return;
+            }
+
+            ThreadPool.QueueUserWorkItem((state) =>
+            {
+                long from = Math.Max(start, Interlocked.Read(ref readaheadEnd));
+                long offset = from;
+                for (; offset < end && !disposing; offset += pageSize)
+                {
+                    Marshal.ReadByte(new IntPtr(baseAddress.ToInt64() + offset));
+                }
+
+                if (offset > from)
+                {
+                    Interlocked.Add(ref readaheadBytes, Math.Min(offset, end) - from);
+                    Interlocked.Exchange(ref readaheadEnd, Math.Min(offset, end));
+                }
+
+                lock (readaheadLock)
+                {
+                    readaheadPending = 0;
+                    Monitor.PulseAll(readaheadLock);
+                }
+            });
+        }
+
+        public string GetStatistics()
+        {
+            long calls = Interlocked.Read(ref getBlockCount);
+            long bytes = Interlocked.Read(ref bytesServed);
+
+            return string.Format("Source {0} bytes, GetBlock {1} calls ({2} sequential), {3} bytes served, avg block {4} bytes, readahead {5} bytes",
+                fileLength,
+                calls,
+                Interlocked.Read(ref sequentialCount),
+                bytes,
+                calls == 0 ? 0 : bytes / calls,
+                Interlocked.Read(ref readaheadBytes));
+        }
+    }
+}
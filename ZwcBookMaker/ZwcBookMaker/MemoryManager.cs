@@ -0,0 +1,116 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Linq;
+using System.Text;
+using System.Diagnostics;
+using System.Runtime.InteropServices;
+using System.Threading;
+
+namespace ZwcBookMaker
+{
+    /// <summary>
+    /// Out of memory handling for the build. The SDK reports OOM through
+    /// FSDK_SetOOMHandler and FPDF_SetErrorHandler. The OOM handler must not
+    /// return to the SDK, whose state is undefined after that, so the build
+    /// process is stopped there and the book has to be built again.
+    /// Also samples the working set to report the peak of each build stage.
+    /// </summary>
+    public class MemoryManager : IDisposable
+    {
+        const int sampleInterval = 50;
+
+        // Handlers are global to the SDK, keep them alive for the whole process.
+        static FSDK_OOM_Handler oomHandler;
+        static FPDF_ErrorHandler errorHandler;
+        static IntPtr oomInfo = IntPtr.Zero;
+
+        object stageLock = new object();
+        List<string> stageNames = new List<string>();
+        Dictionary<string, long> stagePeaks = new Dictionary<string, long>();
+        string currentStage = null;
+        Process process = Process.GetCurrentProcess();
+        Timer sampleTimer;
+
+        public MemoryManager()
+        {
+            if (oomInfo == IntPtr.Zero)
+            {
+                oomHandler = new FSDK_OOM_Handler((pThis) => Abort());
+                errorHandler = new FPDF_ErrorHandler((code, message) =>
+                {
+                    if (code == ErrorCode.FPDFERR_OUT_OF_MEMORY)
+                    {
+                        Abort();
+                    }
+                });
+
+                oomInfo = Marshal.AllocHGlobal(Marshal.SizeOf(typeof(OOM_INFO)));
+                Marshal.StructureToPtr(new OOM_INFO()
+                {
+                    version = 1,
+                    FSDK_OOM_Handler = Marshal.GetFunctionPointerForDelegate(oomHandler)
+                }, oomInfo, false);
+
+                FoxitPDFSDK.FSDK_SetOOMHandler(oomInfo);
+                FoxitPDFSDK.FPDF_SetErrorHandler(errorHandler);
+            }
+
+            sampleTimer = new Timer(SampleWorkingSet, null, 0, sampleInterval);
+        }
+
+        public void Dispose()
+        {
+            sampleTimer.Dispose();
+        }
+
+        /// <summary>
+        /// Called on the SDK thread that ran out of memory, does not return.
+        /// </summary>
+        static void Abort()
+        {
+            Environment.FailFast("PDF SDK is out of memory");
+        }
+
+        public void BeginStage(string name)
+        {
+            lock (stageLock)
+            {
+                if (!stagePeaks.ContainsKey(name))
+                {
+                    stageNames.Add(name);
+                    stagePeaks[name] = 0;
+                }
+                currentStage = name;
+            }
+
+            SampleWorkingSet(null);
+        }
+
+        void SampleWorkingSet(object state)
+        {
+            lock (stageLock)
+            {
+                if (currentStage == null)
+                {
+                    return;
+                }
+
+                process.Refresh();
+                stagePeaks[currentStage] = Math.Max(stagePeaks[currentStage], process.WorkingSet64);
+            }
+        }
+
+        public string GetStatistics()
+        {
+            lock (stageLock)
+            {
+                StringBuilder builder = new StringBuilder();
+                foreach (var name in stageNames)
+                {
+                    builder.AppendFormat("{0}{1} peak {2} MB", builder.Length > 0 ? ", " : "", name, stagePeaks[name] / (1024 * 1024));
+                }
+                return builder.ToString();
+            }
+        }
+    }
+}
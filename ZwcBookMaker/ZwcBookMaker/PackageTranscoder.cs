@@ -0,0 +1,553 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Linq;
+using System.Text;
+using System.Diagnostics;
+using System.IO;
+using System.Threading.Tasks;
+
+namespace ZwcBookMaker
+{
+    /// <summary>
+    /// Rewrites a package whose pages are GIFs, as BookPackager wrote them before
+    /// the symbol codec, without the PDF: GIF pages are coded against a symbol
+    /// dictionary and, with progressive set, get a base layer. Other pages and
+    /// the sections are carried over, see BookPackager for the layout.
+    ///
+    /// Pages are coded in batches, one SymbolCodec per worker, and written in
+    /// order as each batch is done to package.part. package.progress starts
+    /// with [long source length][ulong slot table hash][int progressive] and
+    /// records [int length][int stored page] for every page written, and
+    /// package.symb holds the dictionary, so a run that was stopped picks up
+    /// after the last whole batch. The three files are thrown away when the
+    /// header does not match the package. At the end the old package is kept
+    /// as package.v1.
+    /// </summary>
+    public class PackageTranscoder
+    {
+        // Pages each worker codes between two writes.
+        const int pagesPerWorker = 4;
+
+        const int progressHeaderSize = 20;
+        const int progressRecordSize = 8;
+
+        int workerCount;
+        bool progressive;
+
+        int pageCount = 0;
+        int resumedPageCount = 0;
+        // GIF pages this run coded, resumed and other pages are not counted.
+        int codedPageCount = 0;
+        int duplicatePageCount = 0;
+        long sourceLength = 0;
+        long targetLength = 0;
+        TimeSpan dictionaryTime = TimeSpan.Zero;
+        // The whole second pass: reading, coding, duplicates, writes and flushes.
+        TimeSpan codeTime = TimeSpan.Zero;
+        string codecStatistics = "";
+
+        public PackageTranscoder(int workerCount, bool progressive)
+        {
+            this.workerCount = Math.Max(1, workerCount);
+            this.progressive = progressive;
+        }
+
+        public void Transcode(string packagePath)
+        {
+            string partPath = packagePath + ".part";
+            string progressPath = packagePath + ".progress";
+            string dictionaryPath = packagePath + ".symb";
+
+            int[] slots;
+            List<KeyValuePair<string, byte[]>> sections;
+            Dictionary<int, int> sourceDuplicates;
+            using (FileStream source = File.Open(packagePath, FileMode.Open, FileAccess.Read, FileShare.Read))
+            {
+                slots = ReadSlots(source);
+                sections = ReadSections(source, slots[0]);
+                sourceLength = source.Length;
+            }
+
+            if (sections.Any(section => section.Key == SymbolCodec.SectionTag))
+            {
+                throw new InvalidDataException(string.Format("{0} already has symbol pages", Path.GetFileName(packagePath)));
+            }
+
+            sourceDuplicates = ReadDuplicates(sections);
+            sections.RemoveAll(section => section.Key == BookPackager.DuplicateSectionTag);
+            pageCount = slots.Length - 2;
+
+            // What a stopped run left is only used for the same source, the
+            // header is written before anything else.
+            byte[] progressHeader = GetProgressHeader(sourceLength, slots, progressive);
+            if (!IsSameProgressHeader(progressPath, progressHeader))
+            {
+                File.Delete(partPath);
+                File.Delete(dictionaryPath);
+                File.WriteAllBytes(progressPath, progressHeader);
+            }
+
+            // First pass, or its result from the run that was stopped.
+            byte[] dictionary;
+            if (File.Exists(dictionaryPath))
+            {
+                dictionary = File.ReadAllBytes(dictionaryPath);
+            }
+            else
+            {
+                dictionary = BuildDictionary(packagePath, slots, sourceDuplicates);
+                File.WriteAllBytes(dictionaryPath + ".tmp", dictionary);
+                File.Move(dictionaryPath + ".tmp", dictionaryPath);
+            }
+
+            SymbolCodec[] codecs = new SymbolCodec[workerCount];
+            for (int workerIndex = 0; workerIndex < workerCount; ++workerIndex)
+            {
+                codecs[workerIndex] = new SymbolCodec();
+                codecs[workerIndex].LoadDictionary(dictionary);
+            }
+
+            int headerLength = (pageCount + 2) * 4;
+            int[] lengths = new int[pageCount + 1];
+            int[] storedPages = new int[pageCount + 1];
+            var storedByHash = new Dictionary<ulong, List<int>>();
+
+            var stopwatch = Stopwatch.StartNew();
+            using (FileStream source = File.Open(packagePath, FileMode.Open, FileAccess.Read, FileShare.Read))
+            using (FileStream target = File.Open(partPath, FileMode.OpenOrCreate, FileAccess.ReadWrite))
+            using (FileStream progress = File.Open(progressPath, FileMode.OpenOrCreate, FileAccess.ReadWrite))
+            {
+                int nextPage = Resume(target, progress, headerLength, lengths, storedPages, storedByHash);
+                resumedPageCount = nextPage - 1;
+
+                while (nextPage <= pageCount)
+                {
+                    int batchCount = Math.Min(workerCount * pagesPerWorker, pageCount - nextPage + 1);
+                    byte[][] batch = new byte[batchCount][];
+                    for (int i = 0; i < batchCount; ++i)
+                    {
+                        batch[i] = ReadPage(source, slots, sourceDuplicates, nextPage + i);
+                    }
+                    codedPageCount += batch.Count(IsGif);
+
+                    Parallel.For(0, workerCount, (workerIndex) =>
+                    {
+                        for (int i = workerIndex; i < batchCount; i += workerCount)
+                        {
+                            if (IsGif(batch[i]))
+                            {
+                                batch[i] = BookPackager.EncodeImagePage(codecs[workerIndex], batch[i], true, progressive);
+                            }
+                        }
+                    });
+
+                    MemoryStream records = new MemoryStream();
+                    BinaryWriter recordWriter = new BinaryWriter(records);
+                    for (int i = 0; i < batchCount; ++i, ++nextPage)
+                    {
+                        int storedPage = FindStoredPage(target, batch[i], headerLength, lengths, storedByHash);
+                        if (storedPage > 0)
+                        {
+                            storedPages[nextPage] = storedPage;
+                            ++duplicatePageCount;
+                        }
+                        else
+                        {
+                            target.Seek(0, SeekOrigin.End);
+                            target.Write(batch[i], 0, batch[i].Length);
+                            lengths[nextPage] = batch[i].Length;
+                            AddStoredPage(storedByHash, batch[i], nextPage);
+                        }
+
+                        recordWriter.Write(lengths[nextPage]);
+                        recordWriter.Write(storedPages[nextPage]);
+                    }
+
+                    // Pages reach the disk before the records naming them.
+                    target.Flush(true);
+                    records.WriteTo(progress);
+                    progress.Flush(true);
+                }
+
+                WriteTail(target, headerLength, lengths, storedPages, sections, dictionary);
+                targetLength = target.Length;
+            }
+            codeTime += stopwatch.Elapsed;
+
+            for (int workerIndex = 1; workerIndex < workerCount; ++workerIndex)
+            {
+                codecs[0].MergeStatistics(codecs[workerIndex]);
+            }
+            codecStatistics = codecs[0].GetStatistics();
+
+            File.Replace(partPath, packagePath, packagePath + ".v1");
+            File.Delete(progressPath);
+            File.Delete(dictionaryPath);
+        }
+
+        /// <summary>
+        /// Count the symbols of all GIF pages, each worker over its own share of
+        /// the pages with its own codec, merged in page order.
+        /// </summary>
+        byte[] BuildDictionary(string packagePath, int[] slots, Dictionary<int, int> sourceDuplicates)
+        {
+            var stopwatch = Stopwatch.StartNew();
+
+            SymbolCodec[] codecs = new SymbolCodec[workerCount];
+            int share = (pageCount + workerCount - 1) / workerCount;
+            Parallel.For(0, workerCount, (workerIndex) =>
+            {
+                codecs[workerIndex] = new SymbolCodec();
+                using (FileStream source = File.Open(packagePath, FileMode.Open, FileAccess.Read, FileShare.Read))
+                {
+                    int lastPage = Math.Min(pageCount, (workerIndex + 1) * share);
+                    for (int pageIndex = workerIndex * share + 1; pageIndex <= lastPage; ++pageIndex)
+                    {
+                        byte[] content = ReadPage(source, slots, sourceDuplicates, pageIndex);
+                        if (IsGif(content))
+                        {
+                            codecs[workerIndex].AddPage(content);
+                        }
+                    }
+                }
+            });
+
+            for (int workerIndex = 1; workerIndex < workerCount; ++workerIndex)
+            {
+                codecs[0].Merge(codecs[workerIndex]);
+            }
+
+            byte[] dictionary = codecs[0].BuildDictionary();
+            dictionaryTime += stopwatch.Elapsed;
+            return dictionary;
+        }
+
+        /// <summary>
+        /// Start of package.progress for this source, see the class comment.
+        /// </summary>
+        internal static byte[] GetProgressHeader(long sourceLength, int[] slots, bool progressive)
+        {
+            byte[] slotBytes = new byte[slots.Length * 4];
+            Buffer.BlockCopy(slots, 0, slotBytes, 0, slotBytes.Length);
+
+            MemoryStream header = new MemoryStream();
+            BinaryWriter writer = new BinaryWriter(header);
+            writer.Write(sourceLength);
+            writer.Write(BookPackager.HashContent(slotBytes));
+            writer.Write(progressive ? 1 : 0);
+            writer.Flush();
+            return header.ToArray();
+        }
+
+        /// <summary>
+        /// True when package.progress exists and starts with the header.
+        /// </summary>
+        static bool IsSameProgressHeader(string progressPath, byte[] progressHeader)
+        {
+            if (!File.Exists(progressPath))
+            {
+                return false;
+            }
+
+            byte[] header = new byte[progressHeaderSize];
+            using (FileStream progress = File.OpenRead(progressPath))
+            {
+                if (progress.Read(header, 0, header.Length) != header.Length)
+                {
+                    return false;
+                }
+            }
+            return header.SequenceEqual(progressHeader);
+        }
+
+        /// <summary>
+        /// Drop what a stopped run wrote after its last whole record, returns the
+        /// first page still to code.
+        /// </summary>
+        static int Resume(FileStream target, FileStream progress, int headerLength, int[] lengths, int[] storedPages, Dictionary<ulong, List<int>> storedByHash)
+        {
+            int recordCount = (int)Math.Min((progress.Length - progressHeaderSize) / progressRecordSize, lengths.Length - 1);
+            progress.SetLength(progressHeaderSize + recordCount * progressRecordSize);
+            progress.Seek(progressHeaderSize, SeekOrigin.Begin);
+
+            BinaryReader reader = new BinaryReader(progress);
+            long end = headerLength;
+            for (int pageIndex = 1; pageIndex <= recordCount; ++pageIndex)
+            {
+                lengths[pageIndex] = reader.ReadInt32();
+                storedPages[pageIndex] = reader.ReadInt32();
+                end += lengths[pageIndex];
+            }
+
+            if (target.Length < end)
+            {
+                // Records without their pages, start over.
+                recordCount = 0;
+                end = headerLength;
+                Array.Clear(lengths, 0, lengths.Length);
+                Array.Clear(storedPages, 0, storedPages.Length);
+                progress.SetLength(progressHeaderSize);
+            }
+            target.SetLength(end);
+            progress.Seek(0, SeekOrigin.End);
+
+            // Pages written before are found again for duplicates.
+            target.Seek(headerLength, SeekOrigin.Begin);
+            for (int pageIndex = 1; pageIndex <= recordCount; ++pageIndex)
+            {
+                if (lengths[pageIndex] > 0)
+                {
+                    byte[] content = new byte[lengths[pageIndex]];
+                    target.Read(content, 0, content.Length);
+                    AddStoredPage(storedByHash, content, pageIndex);
+                }
+            }
+
+            return recordCount + 1;
+        }
+
+        static void AddStoredPage(Dictionary<ulong, List<int>> storedByHash, byte[] content, int pageIndex)
+        {
+            ulong hash = BookPackager.HashContent(content);
+            List<int> pages;
+            if (!storedByHash.TryGetValue(hash, out pages))
+            {
+                pages = new List<int>();
+                storedByHash[hash] = pages;
+            }
+            pages.Add(pageIndex);
+        }
+
+        /// <summary>
+        /// The page already written with the same bytes, 0 for none. Candidates
+        /// are read back from the target and compared in full.
+        /// </summary>
+        static int FindStoredPage(FileStream target, byte[] content, int headerLength, int[] lengths, Dictionary<ulong, List<int>> storedByHash)
+        {
+            List<int> pages;
+            if (!storedByHash.TryGetValue(BookPackager.HashContent(content), out pages))
+            {
+                return 0;
+            }
+
+            foreach (int pageIndex in pages)
+            {
+                if (lengths[pageIndex] != content.Length)
+                {
+                    continue;
+                }
+
+                long offset = headerLength;
+                for (int i = 1; i < pageIndex; ++i)
+                {
+                    offset += lengths[i];
+                }
+
+                byte[] stored = new byte[content.Length];
+                target.Seek(offset, SeekOrigin.Begin);
+                target.Read(stored, 0, stored.Length);
+                if (stored.SequenceEqual(content))
+                {
+                    return pageIndex;
+                }
+            }
+
+            return 0;
+        }
+
+        /// <summary>
+        /// Sections and directory after the pages, then the slots in front.
+        /// </summary>
+        static void WriteTail(FileStream target, int headerLength, int[] lengths, int[] storedPages, List<KeyValuePair<string, byte[]>> sections, byte[] dictionary)
+        {
+            int pageCount = lengths.Length - 1;
+
+            MemoryStream duplicates = new MemoryStream();
+            BinaryWriter duplicateWriter = new BinaryWriter(duplicates);
+            int duplicateCount = storedPages.Count(storedPage => storedPage > 0);
+            duplicateWriter.Write(duplicateCount);
+            for (int pageIndex = 1; pageIndex <= pageCount; ++pageIndex)
+            {
+                if (storedPages[pageIndex] > 0)
+                {
+                    duplicateWriter.Write(pageIndex);
+                    duplicateWriter.Write(storedPages[pageIndex]);
+                }
+            }
+
+            sections = new List<KeyValuePair<string, byte[]>>(sections);
+            if (duplicateCount > 0)
+            {
+                sections.Add(new KeyValuePair<string, byte[]>(BookPackager.DuplicateSectionTag, duplicates.ToArray()));
+            }
+            if (BitConverter.ToInt32(dictionary, 0) > 0)
+            {
+                sections.Add(new KeyValuePair<string, byte[]>(SymbolCodec.SectionTag, dictionary));
+            }
+
+            target.Seek(0, SeekOrigin.End);
+            BinaryWriter writer = new BinaryWriter(target);
+            int location = (int)target.Length;
+            int directoryOffset = 0;
+            if (sections.Count > 0)
+            {
+                MemoryStream directory = new MemoryStream();
+                BinaryWriter directoryWriter = new BinaryWriter(directory);
+                directoryWriter.Write(sections.Count);
+                foreach (var section in sections)
+                {
+                    directoryWriter.Write(Encoding.ASCII.GetBytes(section.Key));
+                    directoryWriter.Write(location);
+                    directoryWriter.Write(section.Value.Length);
+
+                    writer.Write(section.Value);
+                    location += section.Value.Length;
+                }
+
+                directoryOffset = location;
+                writer.Write(directory.ToArray());
+            }
+
+            // A page stored elsewhere starts where the next one does.
+            writer.Seek(0, SeekOrigin.Begin);
+            writer.Write(directoryOffset);
+            int pageOffset = headerLength;
+            for (int pageIndex = 1; pageIndex <= pageCount; ++pageIndex)
+            {
+                writer.Write(pageOffset);
+                pageOffset += lengths[pageIndex];
+            }
+            writer.Write(pageOffset);
+            writer.Flush();
+            target.Flush(true);
+        }
+
+        /// <summary>
+        /// Slot 0 and the page slots of a package. InvalidDataException when the
+        /// slots do not fit the file, pages must follow each other in order.
+        /// </summary>
+        internal static int[] ReadSlots(FileStream package)
+        {
+            if (package.Length < 8)
+            {
+                throw new InvalidDataException(string.Format("{0} is too short for a package", Path.GetFileName(package.Name)));
+            }
+
+            BinaryReader reader = new BinaryReader(package);
+            package.Seek(0, SeekOrigin.Begin);
+            int directoryOffset = reader.ReadInt32();
+            int firstPage = reader.ReadInt32();
+            if (firstPage < 8 || firstPage % 4 != 0 || firstPage > package.Length)
+            {
+                throw new InvalidDataException(string.Format("{0} has no valid slot table", Path.GetFileName(package.Name)));
+            }
+
+            int[] slots = new int[firstPage / 4];
+            slots[0] = directoryOffset;
+            slots[1] = firstPage;
+            for (int slot = 2; slot < slots.Length; ++slot)
+            {
+                slots[slot] = reader.ReadInt32();
+                if (slots[slot] < slots[slot - 1] || slots[slot] > package.Length)
+                {
+                    throw new InvalidDataException(string.Format("{0} has a page outside the file at slot {1}", Path.GetFileName(package.Name), slot));
+                }
+            }
+
+            int pagesEnd = slots[slots.Length - 1];
+            if (directoryOffset != 0 && (directoryOffset < pagesEnd || directoryOffset > package.Length - 4))
+            {
+                throw new InvalidDataException(string.Format("{0} has no valid section directory", Path.GetFileName(package.Name)));
+            }
+            return slots;
+        }
+
+        internal static List<KeyValuePair<string, byte[]>> ReadSections(FileStream package, int directoryOffset)
+        {
+            var sections = new List<KeyValuePair<string, byte[]>>();
+            if (directoryOffset == 0)
+            {
+                return sections;
+            }
+
+            BinaryReader reader = new BinaryReader(package);
+            package.Seek(directoryOffset, SeekOrigin.Begin);
+            int count = reader.ReadInt32();
+            var entries = new List<Tuple<string, int, int>>();
+            if (count < 0 || count > (package.Length - directoryOffset - 4) / 12)
+            {
+                throw new InvalidDataException(string.Format("{0} has no valid section directory", Path.GetFileName(package.Name)));
+            }
+
+            for (int i = 0; i < count; ++i)
+            {
+                string tag = Encoding.ASCII.GetString(reader.ReadBytes(4));
+                var entry = Tuple.Create(tag, reader.ReadInt32(), reader.ReadInt32());
+                if (entry.Item2 < 0 || entry.Item3 < 0 || (long)entry.Item2 + entry.Item3 > directoryOffset)
+                {
+                    throw new InvalidDataException(string.Format("{0} has section {1} outside the file", Path.GetFileName(package.Name), tag));
+                }
+                entries.Add(entry);
+            }
+
+            foreach (var entry in entries)
+            {
+                package.Seek(entry.Item2, SeekOrigin.Begin);
+                sections.Add(new KeyValuePair<string, byte[]>(entry.Item1, reader.ReadBytes(entry.Item3)));
+            }
+            return sections;
+        }
+
+        internal static Dictionary<int, int> ReadDuplicates(List<KeyValuePair<string, byte[]>> sections)
+        {
+            var duplicates = new Dictionary<int, int>();
+            foreach (var section in sections.Where(section => section.Key == BookPackager.DuplicateSectionTag))
+            {
+                int count = BitConverter.ToInt32(section.Value, 0);
+                for (int i = 0; i < count; ++i)
+                {
+                    duplicates[BitConverter.ToInt32(section.Value, 4 + i * 8)] = BitConverter.ToInt32(section.Value, 8 + i * 8);
+                }
+            }
+            return duplicates;
+        }
+
+        /// <summary>
+        /// Bytes of a page, from the page holding them when it is a duplicate.
+        /// </summary>
+        internal static byte[] ReadPage(FileStream package, int[] slots, Dictionary<int, int> duplicates, int pageIndex)
+        {
+            int storedPage;
+            if (!duplicates.TryGetValue(pageIndex, out storedPage))
+            {
+                storedPage = pageIndex;
+            }
+
+            byte[] content = new byte[slots[storedPage + 1] - slots[storedPage]];
+            package.Seek(slots[storedPage], SeekOrigin.Begin);
+            package.Read(content, 0, content.Length);
+            return content;
+        }
+
+        static bool IsGif(byte[] content)
+        {
+            return content.Length >= 3 && content[0] == 'G' && content[1] == 'I' && content[2] == 'F';
+        }
+
+        public string GetStatistics()
+        {
+            double seconds = (dictionaryTime + codeTime).TotalSeconds;
+            double pagesPerSecond = seconds > 0 ? codedPageCount / seconds : 0;
+            return string.Format("Coded {0} GIF pages of {1} ({2} resumed, {3} stored once), {4:F1} GIF pages/s on {5} workers, {6:F1} per core, {7} to {8} bytes",
+                codedPageCount,
+                pageCount,
+                resumedPageCount,
+                duplicatePageCount,
+                pagesPerSecond,
+                workerCount,
+                pagesPerSecond / workerCount,
+                sourceLength,
+                targetLength) + Environment.NewLine + codecStatistics;
+        }
+    }
+}
@@ -0,0 +1,20 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Linq;
+using System.Text;
+using System.Drawing;
+
+namespace ZwcBookMaker
+{
+    /// <summary>
+    /// A link on a source page, boxes in pixels of the page rendered by RenderPage.
+    /// Internal links have a target page and row, web links a URL and TargetPage -1.
+    /// </summary>
+    public class PageLink
+    {
+        public Rectangle Box;
+        public int TargetPage;
+        public int TargetY;
+        public string Url;
+    }
+}
@@ -0,0 +1,79 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Linq;
+using System.Text;
+using System.IO;
+using System.Drawing;
+
+namespace ZwcBookMaker
+{
+    /// <summary>
+    /// Where each source page ended up. Source pages are added as parts, one
+    /// per column or band of kept rows and each at its own zoom, which are
+    /// stacked without gaps and cut into output pages. A part is recorded with
+    /// its source page, its bounds on the rendered page, its zoom and where it
+    /// starts on the stack; output pages by where they start. The reader maps
+    /// a source position through its part to the stack and finds the output
+    /// page by binary search, and the other way round for an output page.
+    ///
+    /// Section layout:
+    ///   int segmentCount
+    ///   segmentCount x [int sourcePage][int left][int top][int right][int bottom]
+    ///                  [int scale, in 1/65536][int top on the stack]
+    ///   int end of the last segment on the stack
+    ///   int outputPageCount
+    ///   (outputPageCount + 1) x int top of each output page, then the end
+    /// </summary>
+    public class PageMapBuilder : IPackageSection
+    {
+        public const string SectionTag = "PMAP";
+
+        public string Tag
+        {
+            get
+            {
+                return SectionTag;
+            }
+        }
+
+        public void AddSourcePage(FoxitPDFReader textReader, PageText pageText)
+        {
+        }
+
+        public byte[] Build(FoxitPDFReader textReader, PageOutPutter outPutter)
+        {
+            MemoryStream section = new MemoryStream();
+            using (BinaryWriter writer = new BinaryWriter(section))
+            {
+                long end;
+                var segments = outPutter.GetSegments(out end);
+                writer.Write(segments.Count);
+                foreach (var segment in segments)
+                {
+                    Rectangle bounds = segment.Region.Bounds;
+                    writer.Write(segment.SourcePageIndex);
+                    writer.Write(bounds.Left);
+                    writer.Write(bounds.Top);
+                    writer.Write(bounds.Right);
+                    writer.Write(bounds.Bottom);
+                    writer.Write((int)Math.Round(segment.Region.Scale * 65536));
+                    writer.Write((int)segment.BookTop);
+                }
+                writer.Write((int)end);
+
+                WriteBounds(writer, outPutter.GetOutputPageBounds());
+            }
+
+            return section.ToArray();
+        }
+
+        static void WriteBounds(BinaryWriter writer, long[] bounds)
+        {
+            writer.Write(bounds.Length - 1);
+            foreach (long bound in bounds)
+            {
+                writer.Write((int)bound);
+            }
+        }
+    }
+}
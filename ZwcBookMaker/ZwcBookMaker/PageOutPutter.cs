@@ -20,28 +20,159 @@ namespace ZwcBookMaker
         Graphics graphics;
         int currentY = 0;
 
+        // Book y of the top of the canvas, of each source page and of each output page.
+        long canvasTop = 0;
+        List<long> sourcePageTops = new List<long>();
+        List<long> outputPageTops = new List<long>();
+        long sourceEnd = 0;
+
+        // Where each part of a source page was put, in the order they were added.
+        // A source page without columns is one part.
+        public class PageSegment
+        {
+            public int SourcePageIndex;
+            public PageRegion Region;
+            public long BookTop;
+        }
+        List<PageSegment> segments = new List<PageSegment>();
+        List<int> sourceFirstSegments = new List<int>();
+
+        // Text line boxes on the canvas.
+        List<Rectangle> textLines = new List<Rectangle>();
+
+        // Cuts made through text or pixels because no gap was found.
+        int forcedCutCount = 0;
+
+        // White rows added by Flush below the last content, never a page of their own.
+        int paddingHeight = 0;
+        int blankPageCount = 0;
+
+        GrayQuantizer quantizer = new GrayQuantizer();
+        DitherMode ditherMode = DitherMode.Auto;
+
+        // Null unless blank rows are squeezed out, see CompactWhitespace.
+        WhitespaceCompactor compactor = null;
+
         public PageOutPutter(string targetFolder)
         {
             this.targetFolder = targetFolder;
             graphics = Graphics.FromImage(canvas);
         }
 
-        public void AddPage(Bitmap bitmap)
+        /// <summary>
+        /// Add a source page. With the boxes of its text lines, pages are cut
+        /// between lines and pixels are only scanned where there is no text.
+        /// </summary>
+        public void AddPage(Bitmap bitmap, List<Rectangle> pageTextLines = null)
         {
-            graphics.DrawImageUnscaled(bitmap, 0, currentY);
-            currentY += bitmap.Height;
-            SavePage();
+            BeginSourcePage();
+            AddRegion(bitmap, new PageRegion() { Bounds = new Rectangle(0, 0, bitmap.Width, bitmap.Height), Scale = 1 }, pageTextLines);
+        }
+
+        /// <summary>
+        /// Add a source page region by region, from the bitmap of the regions
+        /// stacked at their zoom by FoxitPDFReader.RenderPage.
+        /// </summary>
+        public void AddPage(Bitmap stacked, List<PageRegion> regions, List<Rectangle> pageTextLines)
+        {
+            BeginSourcePage();
+            int y = 0;
+            foreach (var region in regions)
+            {
+                Size size = region.GetPixelSize();
+                using (Bitmap regionBitmap = stacked.Clone(new Rectangle(0, y, size.Width, size.Height), stacked.PixelFormat))
+                {
+                    AddRegion(regionBitmap, region, pageTextLines);
+                }
+                y += size.Height;
+            }
+        }
+
+        /// <summary>
+        /// Start a source page that is added in parts by AddRegion.
+        /// </summary>
+        public void BeginSourcePage()
+        {
+            sourcePageTops.Add(canvasTop + currentY);
+            sourceFirstSegments.Add(segments.Count);
+        }
+
+        /// <summary>
+        /// Add a part of the current source page, rendered at the zoom of the region.
+        /// Text line boxes are given for the whole source page, those with their
+        /// middle in the region are moved to the canvas.
+        /// </summary>
+        public void AddRegion(Bitmap bitmap, PageRegion region, List<Rectangle> pageTextLines)
+        {
+            if (compactor == null)
+            {
+                AddRows(bitmap, 0, bitmap.Height, region, pageTextLines);
+                return;
+            }
+
+            // Each band of kept rows is a part of its own, rows left out are
+            // found in the part above them by FindSegment.
+            foreach (int[] rows in compactor.Compact(bitmap))
+            {
+                int top = region.Bounds.Top + (int)(rows[0] / region.Scale);
+                int bottom = Math.Min(region.Bounds.Bottom, region.Bounds.Top + (int)Math.Ceiling(rows[1] / region.Scale));
+                PageRegion band = new PageRegion()
+                {
+                    Bounds = Rectangle.FromLTRB(region.Bounds.Left, top, region.Bounds.Right, Math.Max(bottom, top + 1)),
+                    Scale = region.Scale
+                };
+                AddRows(bitmap, rows[0], rows[1], band, pageTextLines);
+            }
+        }
+
+        /// <summary>
+        /// Add rows [top, bottom) of a region bitmap, region is where they are on the source page.
+        /// A zoomed region can be taller than the canvas, it is copied in chunks
+        /// that fit and pages are cut between them.
+        /// </summary>
+        void AddRows(Bitmap bitmap, int top, int bottom, PageRegion region, List<Rectangle> pageTextLines)
+        {
+            segments.Add(new PageSegment()
+            {
+                SourcePageIndex = sourcePageTops.Count - 1,
+                Region = region,
+                BookTop = canvasTop + currentY
+            });
+
+            if (pageTextLines != null)
+            {
+                foreach (var line in pageTextLines)
+                {
+                    if (line.Height > 0 && region.Bounds.Contains((line.Left + line.Right) / 2, (line.Top + line.Bottom) / 2))
+                    {
+                        Rectangle box = ToRegion(region, line);
+                        textLines.Add(new Rectangle(box.X, box.Y + currentY, box.Width, box.Height));
+                    }
+                }
+            }
+
+            for (int y = top; y < bottom; )
+            {
+                Rectangle rows = new Rectangle(0, y, bitmap.Width, Math.Min(bottom - y, canvasHeight - currentY));
+                graphics.DrawImage(bitmap, new Rectangle(0, currentY, rows.Width, rows.Height), rows, GraphicsUnit.Pixel);
+                currentY += rows.Height;
+                y += rows.Height;
+                sourceEnd = canvasTop + currentY;
+                SavePage();
+            }
         }
 
         public void Flush()
         {
+            // A book without any content still gets its one page.
+            paddingHeight = outputPageTops.Count > 0 ? pageHeight : 0;
             currentY += pageHeight;
             SavePage();
         }
 
         private void SavePage()
         {
-            while (currentY >= pageHeight)
+            while (currentY >= pageHeight && currentY > paddingHeight)
             {
                 int cutHeight = CalculateCutHeight();
 
@@ -52,6 +183,7 @@ namespace ZwcBookMaker
                 graphics.Clear(Color.White);
                 graphics.DrawImage(canvas, pageRect, pageRect, GraphicsUnit.Pixel);
                 SaveImage(page);
+                outputPageTops.Add(canvasTop);
 
                 // Refresh canvas
                 Bitmap newCanvas = new Bitmap(pageWidth, canvasHeight);
@@ -62,15 +194,62 @@ namespace ZwcBookMaker
                 this.graphics = newGraphics;
 
                 currentY -= cutHeight;
+                canvasTop += cutHeight;
+
+                textLines = textLines
+                    .Where(line => line.Bottom > cutHeight)
+                    .Select(line => new Rectangle(line.X, line.Y - cutHeight, line.Width, line.Height))
+                    .ToList();
             }
         }
 
         private void SaveImage(Bitmap page)
         {
             string filePath = GetNewPathParth();
-            page.RotateFlip(RotateFlipType.Rotate90FlipNone);
+            if (IsBlank(page))
+            {
+                // Scanner noise cleared, so all blank pages encode to the same
+                // bytes and the packager stores them once.
+                using (Graphics graphics = Graphics.FromImage(page))
+                {
+                    graphics.Clear(Color.White);
+                }
+                ++blankPageCount;
+            }
 
-            page.Save(filePath, ImageFormat.Gif);
+            // Turned 90 degrees clockwise while it is quantized.
+            using (Bitmap grayPage = quantizer.Quantize(page, ditherMode, true))
+            {
+                grayPage.Save(filePath, ImageFormat.Gif);
+            }
+        }
+
+        /// <summary>
+        /// Row profile of the page: blank when no row has a pixel darker than
+        /// the near white of FindWhiteRow.
+        /// </summary>
+        static unsafe bool IsBlank(Bitmap page)
+        {
+            BitmapData data = page.LockBits(new Rectangle(0, 0, page.Width, page.Height), ImageLockMode.ReadOnly, PixelFormat.Format32bppArgb);
+            try
+            {
+                for (int y = 0; y < data.Height; ++y)
+                {
+                    byte* pixel = (byte*)data.Scan0 + (long)y * data.Stride;
+                    for (int x = 0; x < data.Width; ++x, pixel += 4)
+                    {
+                        if (pixel[0] < 220 || pixel[1] < 220 || pixel[2] < 220)
+                        {
+                            return false;
+                        }
+                    }
+                }
+                return true;
+            }
+            finally
+            {
+                page.UnlockBits(data);
+            }
         }
 
         int pageIndex = 1;
@@ -86,9 +265,243 @@ namespace ZwcBookMaker
             return pageIndex - 1;
         }
 
+        /// <summary>
+        /// The parts of all source pages in the order they were added, each ends
+        /// where the next starts. end receives the book y where the last one ends.
+        /// </summary>
+        public List<PageSegment> GetSegments(out long end)
+        {
+            end = sourceEnd;
+            return segments.ToList();
+        }
+
+        /// <summary>
+        /// Book y of the top of each output page, followed by the end of the last one.
+        /// </summary>
+        public long[] GetOutputPageBounds()
+        {
+            return outputPageTops.Concat(new long[] { canvasTop }).ToArray();
+        }
+
+        public int GetSourcePageCount()
+        {
+            return sourcePageTops.Count;
+        }
+
+        /// <summary>
+        /// How pages are brought to the 16 gray levels, used from the next saved page on.
+        /// </summary>
+        public DitherMode DitherMode
+        {
+            get
+            {
+                return ditherMode;
+            }
+            set
+            {
+                ditherMode = value;
+            }
+        }
+
+        /// <summary>
+        /// Squeeze blank rows out of pages added from now on, see WhitespaceCompactor.
+        /// </summary>
+        public bool CompactWhitespace
+        {
+            get
+            {
+                return compactor != null;
+            }
+            set
+            {
+                if (value != CompactWhitespace)
+                {
+                    compactor = value ? new WhitespaceCompactor() : null;
+                }
+            }
+        }
+
+        public string GetStatistics()
+        {
+            return string.Format("Output {0} pages, {1} blank, {2} forced cuts", GetOutputPageCount(), blankPageCount, forcedCutCount)
+                + Environment.NewLine + quantizer.GetStatistics()
+                + (compactor != null ? Environment.NewLine + compactor.GetStatistics() : "");
+        }
+
+        /// <summary>
+        /// The output page showing pixel (x, y) of a source page, both are counted
+        /// in the order they were added. Valid after Flush.
+        /// </summary>
+        public int GetOutputPageIndex(int sourcePageIndex, int x, int y)
+        {
+            int pageX, pageY;
+            return GetOutputPageIndex(sourcePageIndex, x, y, out pageX, out pageY);
+        }
+
+        /// <summary>
+        /// Same as above, pageX and pageY receive the pixel on the output page before rotation.
+        /// </summary>
+        public int GetOutputPageIndex(int sourcePageIndex, int x, int y, out int pageX, out int pageY)
+        {
+            PageSegment segment = FindSegment(sourcePageIndex, x, y);
+            Point point = ToRegion(segment.Region, new Rectangle(x, y, 0, 0)).Location;
+            pageX = point.X;
+            return GetOutputPageIndex(segment.BookTop + point.Y, out pageY);
+        }
+
+        /// <summary>
+        /// The output page showing the middle of a box on a source page, pageBox
+        /// receives the box on that page before rotation, zoomed as its region.
+        /// </summary>
+        public int GetOutputPageIndex(int sourcePageIndex, Rectangle box, out Rectangle pageBox)
+        {
+            int middleX = (box.Left + box.Right) / 2;
+            int middleY = (box.Top + box.Bottom) / 2;
+            PageSegment segment = FindSegment(sourcePageIndex, middleX, middleY);
+            Rectangle regionBox = ToRegion(segment.Region, box);
+
+            int pageY;
+            int middle = (regionBox.Top + regionBox.Bottom) / 2;
+            int page = GetOutputPageIndex(segment.BookTop + middle, out pageY);
+            pageBox = new Rectangle(regionBox.X, pageY - (middle - regionBox.Top), regionBox.Width, regionBox.Height);
+            return page;
+        }
+
+        int GetOutputPageIndex(long bookY, out int pageY)
+        {
+            int index = outputPageTops.BinarySearch(bookY);
+            if (index < 0)
+            {
+                // Not a page top, take the page starting before it.
+                index = ~index - 1;
+            }
+            index = Math.Max(index, 0);
+
+            pageY = (int)(bookY - outputPageTops[index]);
+            return index + 1;
+        }
+
+        /// <summary>
+        /// The part of a source page holding a pixel. Outside of all parts, the
+        /// first part level with it or else the last part above it.
+        /// </summary>
+        PageSegment FindSegment(int sourcePageIndex, int x, int y)
+        {
+            int first = sourceFirstSegments[sourcePageIndex];
+            int end = sourcePageIndex + 1 < sourceFirstSegments.Count ? sourceFirstSegments[sourcePageIndex + 1] : segments.Count;
+
+            PageSegment found = null;
+            for (int index = first; index < end; ++index)
+            {
+                Rectangle bounds = segments[index].Region.Bounds;
+                if (bounds.Contains(x, y))
+                {
+                    return segments[index];
+                }
+                if (y >= bounds.Top && (found == null || y >= found.Region.Bounds.Bottom))
+                {
+                    found = segments[index];
+                }
+            }
+
+            return found ?? segments[first];
+        }
+
+        /// <summary>
+        /// A box on a source page to pixels of the bitmap of a region.
+        /// </summary>
+        static Rectangle ToRegion(PageRegion region, Rectangle box)
+        {
+            double scale = region.Scale;
+            return new Rectangle(
+                (int)((box.X - region.Bounds.X) * scale),
+                (int)((box.Y - region.Bounds.Y) * scale),
+                (int)(box.Width * scale),
+                (int)(box.Height * scale));
+        }
+
+        /// <summary>
+        /// A box on an output page before rotation to the box on the saved image,
+        /// which SaveImage turns 90 degrees clockwise.
+        /// </summary>
+        public static Rectangle RotateToSavedPage(Rectangle box)
+        {
+            return Rectangle.FromLTRB(pageHeight - box.Bottom, box.Left, pageHeight - box.Top, box.Right);
+        }
+
+        /// <summary>
+        /// Where to end the page: between two text lines if possible. A large gap
+        /// without text may hold a figure, there the lowest white pixel row is used.
+        /// </summary>
         public int CalculateCutHeight()
         {
-            for (int yIndex = pageHeight - 1; yIndex >= 0; --yIndex)
+            // Overlapping lines merged into bands, top to bottom.
+            List<int[]> bands = new List<int[]>();
+            foreach (var line in textLines.Where(line => line.Top < pageHeight).OrderBy(line => line.Top))
+            {
+                if (bands.Count > 0 && line.Top < bands[bands.Count - 1][1])
+                {
+                    bands[bands.Count - 1][1] = Math.Max(bands[bands.Count - 1][1], line.Bottom);
+                }
+                else
+                {
+                    bands.Add(new int[] { line.Top, line.Bottom });
+                }
+            }
+
+            if (bands.Count > 0)
+            {
+                int maxLineGap = 2 * (int)bands.Average(band => band[1] - band[0]);
+                int nextTop = textLines.Where(line => line.Top >= pageHeight).Select(line => line.Top).DefaultIfEmpty(currentY).Min();
+
+                for (int index = bands.Count - 1; index >= -1; --index)
+                {
+                    int gapStart = index >= 0 ? bands[index][1] : 0;
+                    int gapEnd = Math.Min(nextTop, pageHeight);
+                    if (gapEnd > gapStart)
+                    {
+                        if (nextTop - gapStart <= maxLineGap)
+                        {
+                            // Space between lines of text.
+                            return gapEnd;
+                        }
+
+                        int whiteRow = FindWhiteRow(gapStart, gapEnd);
+                        if (whiteRow >= 0)
+                        {
+                            return whiteRow + 1;
+                        }
+                        if (gapStart > 0)
+                        {
+                            return gapStart;
+                        }
+                    }
+
+                    if (index >= 0)
+                    {
+                        nextTop = bands[index][0];
+                    }
+                }
+
+                ++forcedCutCount;
+                return pageHeight;
+            }
+
+            int row = FindWhiteRow(0, pageHeight);
+            if (row < 0)
+            {
+                ++forcedCutCount;
+                return pageHeight;
+            }
+            return row + 1;
+        }
+
+        /// <summary>
+        /// Lowest near white row in [top, bottom), -1 if there is none.
+        /// </summary>
+        int FindWhiteRow(int top, int bottom)
+        {
+            for (int yIndex = bottom - 1; yIndex >= top; --yIndex)
             {
                 bool isWhiteLine = true;
                 for (int xIndex = 0; xIndex < pageWidth; ++xIndex)
@@ -103,11 +516,11 @@ namespace ZwcBookMaker
 
                 if (isWhiteLine)
                 {
-                    return yIndex + 1;
+                    return yIndex;
                 }
             }
 
-            return pageHeight;
+            return -1;
         }
     }
 }
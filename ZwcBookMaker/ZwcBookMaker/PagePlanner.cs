@@ -0,0 +1,74 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Linq;
+using System.Text;
+using System.Drawing;
+
+namespace ZwcBookMaker
+{
+    /// <summary>
+    /// Text pre-pass of the build. The text of a page is extracted before the
+    /// page is rendered, its columns and zoom are planned from the text and
+    /// image boxes, and the renderer draws it once at the planned zoom. The
+    /// text is kept until BuildBook takes it for the sections.
+    ///
+    /// Not thread safe, plans are made on the thread that asks for a batch.
+    /// </summary>
+    public class PagePlanner
+    {
+        FoxitPDFReader textReader;
+        ColumnDetector columnDetector = new ColumnDetector();
+        PageZoom pageZoom = new PageZoom();
+
+        // Pages planned and not taken yet.
+        Dictionary<int, PageText> texts = new Dictionary<int, PageText>();
+        Dictionary<int, List<PageRegion>> plans = new Dictionary<int, List<PageRegion>>();
+
+        public PagePlanner(FoxitPDFReader textReader)
+        {
+            this.textReader = textReader;
+        }
+
+        /// <summary>
+        /// Regions to render a page as, see FoxitPDFReader.RenderPage, null for
+        /// the whole page as it is.
+        /// </summary>
+        public List<PageRegion> GetPlan(int pageIndex)
+        {
+            List<PageRegion> plan;
+            if (plans.TryGetValue(pageIndex, out plan))
+            {
+                return plan;
+            }
+
+            PageText pageText = new PageText();
+            textReader.ExtractText(pageIndex, pageText);
+
+            Size pageSize = new Size(800, (int)(800 * pageText.Height / pageText.Width));
+            Rectangle contentBounds;
+            plan = columnDetector.Detect(pageSize, pageText, out contentBounds);
+            plan = pageZoom.Plan(pageSize, contentBounds, plan, pageText.GetBodyFontSize());
+
+            texts[pageIndex] = pageText;
+            plans[pageIndex] = plan;
+            return plan;
+        }
+
+        /// <summary>
+        /// The text and plan of a page, which is forgotten after this.
+        /// </summary>
+        public PageText TakeText(int pageIndex, out List<PageRegion> plan)
+        {
+            plan = GetPlan(pageIndex);
+            PageText pageText = texts[pageIndex];
+            texts.Remove(pageIndex);
+            plans.Remove(pageIndex);
+            return pageText;
+        }
+
+        public string GetStatistics()
+        {
+            return columnDetector.GetStatistics() + Environment.NewLine + pageZoom.GetStatistics();
+        }
+    }
+}
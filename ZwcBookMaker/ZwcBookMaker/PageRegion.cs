@@ -0,0 +1,27 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Linq;
+using System.Text;
+using System.Drawing;
+
+namespace ZwcBookMaker
+{
+    /// <summary>
+    /// A part of a source page that is added to the book on its own. Bounds are
+    /// in pixels of the page rendered by RenderPage, Scale is the zoom the part
+    /// is rendered at, so it is Bounds.Width * Scale pixels wide.
+    /// </summary>
+    public class PageRegion
+    {
+        public Rectangle Bounds;
+        public double Scale;
+
+        /// <summary>
+        /// Size of the part rendered at its zoom.
+        /// </summary>
+        public Size GetPixelSize()
+        {
+            return new Size(Math.Max(1, (int)(Bounds.Width * Scale)), Math.Max(1, (int)(Bounds.Height * Scale)));
+        }
+    }
+}
@@ -0,0 +1,111 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Linq;
+using System.Text;
+using System.Drawing;
+
+namespace ZwcBookMaker
+{
+    /// <summary>
+    /// The characters of a source page as parallel arrays, filled by
+    /// FoxitPDFReader.ExtractText. One instance is reused page after page, the
+    /// arrays only grow, so readers must copy what they keep.
+    ///
+    /// Boxes are in PDF user space, points with the origin at the bottom left of
+    /// the page. Generated characters (spaces and line breaks added by the text
+    /// analysis) have empty boxes, characters without a unicode value are '\0'.
+    /// </summary>
+    public class PageText
+    {
+        public int PageIndex;
+        public double Width;
+        public double Height;
+
+        public int Count;
+        public char[] Unicode = new char[0];
+        public bool[] IsGenerated = new bool[0];
+        public float[] FontSize = new float[0];
+        public int[] FontId = new int[0];
+        public float[] Left = new float[0];
+        public float[] Top = new float[0];
+        public float[] Right = new float[0];
+        public float[] Bottom = new float[0];
+
+        // Text line boxes in pixels of the page rendered by RenderPage.
+        public List<Rectangle> Lines = new List<Rectangle>();
+
+        // Boxes of the image objects, in the same pixels.
+        public List<Rectangle> Images = new List<Rectangle>();
+
+        public int FontCount;
+
+        /// <summary>
+        /// Start a page of count characters.
+        /// </summary>
+        public void Reset(int pageIndex, double width, double height, int count)
+        {
+            PageIndex = pageIndex;
+            Width = width;
+            Height = height;
+            Count = count;
+            FontCount = 0;
+            Lines.Clear();
+            Images.Clear();
+
+            if (Unicode.Length < count)
+            {
+                int capacity = Math.Max(count, Unicode.Length * 2);
+                Unicode = new char[capacity];
+                IsGenerated = new bool[capacity];
+                FontSize = new float[capacity];
+                FontId = new int[capacity];
+                Left = new float[capacity];
+                Top = new float[capacity];
+                Right = new float[capacity];
+                Bottom = new float[capacity];
+            }
+        }
+
+        /// <summary>
+        /// Box of a character in pixels of the page rendered by RenderPage.
+        /// </summary>
+        public Rectangle GetPixelBox(int index)
+        {
+            double scale = 800 / Width;
+            return Rectangle.FromLTRB(
+                (int)(Left[index] * scale),
+                (int)((Height - Top[index]) * scale),
+                (int)Math.Ceiling(Right[index] * scale),
+                (int)Math.Ceiling((Height - Bottom[index]) * scale));
+        }
+
+        /// <summary>
+        /// Em size of the font used by most characters, in pixels of the page
+        /// rendered by RenderPage, 0 for a page without text.
+        /// </summary>
+        public double GetBodyFontSize()
+        {
+            // Character count per size in half points.
+            Dictionary<double, int> sizes = new Dictionary<double, int>();
+            for (int index = 0; index < Count; ++index)
+            {
+                if (IsGenerated[index] || Unicode[index] == '\0' || char.IsWhiteSpace(Unicode[index]))
+                {
+                    continue;
+                }
+
+                double size = Math.Round(FontSize[index] * 2) / 2;
+                int count;
+                sizes.TryGetValue(size, out count);
+                sizes[size] = count + 1;
+            }
+
+            if (sizes.Count == 0)
+            {
+                return 0;
+            }
+
+            return sizes.OrderByDescending(size => size.Value).First().Key * 800 / Width;
+        }
+    }
+}
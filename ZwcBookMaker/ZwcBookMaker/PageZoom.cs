@@ -0,0 +1,106 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Linq;
+using System.Text;
+using System.Drawing;
+
+namespace ZwcBookMaker
+{
+    /// <summary>
+    /// Picks the zoom of each source page so body text comes out about the same
+    /// size whatever the page size of the PDF, and crops the page margins. Small
+    /// type is zoomed in, big type is zoomed out to save output pages.
+    /// </summary>
+    public class PageZoom
+    {
+        // Body text em size on the output page, the size the reflow engine uses.
+        public const double DefaultTargetFontSize = 28;
+
+        const int pageWidth = 800;
+        const int contentMargin = 16;
+        const double minScale = 0.5;
+        const double maxScale = 2.0;
+
+        // Zooms this close to 1 are not worth rendering the page in parts.
+        const double snapToOne = 0.05;
+
+        double targetFontSize;
+        int pageCount = 0;
+        int zoomedPageCount = 0;
+        double scaleSum = 0;
+
+        public PageZoom(double targetFontSize = DefaultTargetFontSize)
+        {
+            this.targetFontSize = targetFontSize;
+        }
+
+        /// <summary>
+        /// Regions to render a page as, from the regions found by ColumnDetector
+        /// (null for one column) and the body font size. Null when the page is
+        /// rendered whole at 800 pixels wide.
+        /// </summary>
+        public List<PageRegion> Plan(Size pageSize, Rectangle contentBounds, List<PageRegion> columns, double bodyFontSize)
+        {
+            ++pageCount;
+            if (contentBounds.IsEmpty)
+            {
+                scaleSum += 1;
+                return columns;
+            }
+
+            Rectangle page = new Rectangle(Point.Empty, pageSize);
+            Rectangle crop = Rectangle.Inflate(contentBounds, contentMargin, contentMargin);
+            crop.Intersect(page);
+
+            List<PageRegion> regions = columns ?? new List<PageRegion>() { new PageRegion() { Bounds = page, Scale = 1 } };
+            double fontScale = bodyFontSize > 0 ? targetFontSize / bodyFontSize : maxScale;
+
+            List<PageRegion> planned = new List<PageRegion>();
+            foreach (var region in regions)
+            {
+                Rectangle bounds = Rectangle.Intersect(region.Bounds, crop);
+                if (bounds.Width <= 0 || bounds.Height <= 0)
+                {
+                    continue;
+                }
+
+                // Never wider than the output page.
+                double scale = Math.Min((double)pageWidth / bounds.Width, fontScale);
+                scale = Math.Max(minScale, Math.Min(maxScale, scale));
+                if (Math.Abs(scale - 1) < snapToOne)
+                {
+                    scale = 1;
+                }
+
+                planned.Add(new PageRegion() { Bounds = bounds, Scale = scale });
+            }
+
+            if (planned.Count == 0)
+            {
+                scaleSum += 1;
+                return columns;
+            }
+
+            double pageScale = planned.Sum(region => region.Scale * region.Bounds.Height) / planned.Sum(region => region.Bounds.Height);
+            scaleSum += pageScale;
+            if (pageScale != 1)
+            {
+                ++zoomedPageCount;
+            }
+
+            if (planned.Count == 1 && planned[0].Bounds == page && planned[0].Scale == 1)
+            {
+                return null;
+            }
+            return planned;
+        }
+
+        public string GetStatistics()
+        {
+            return string.Format("Zoom changed on {0} of {1} pages, average zoom {2:F2}",
+                zoomedPageCount,
+                pageCount,
+                pageCount > 0 ? scaleSum / pageCount : 1);
+        }
+    }
+}
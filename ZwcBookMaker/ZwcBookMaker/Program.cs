@@ -4,6 +4,9 @@ using System.Linq;
 using System.Windows.Forms;
 using System.Threading;
 using System.Globalization;
+using System.IO;
+using zwcHelper;
+using Glassesol.Common;
 
 namespace ZwcBookMaker
 {
@@ -13,14 +16,54 @@ namespace ZwcBookMaker
         /// The main entry point for the application.
         /// </summary>
         [STAThread]
-        static void Main()
+        static void Main(string[] args)
         {
             Thread.CurrentThread.CurrentCulture = CultureInfo.CreateSpecificCulture("en-us");
             Thread.CurrentThread.CurrentUICulture = CultureInfo.CreateSpecificCulture("en-us");
 
+            // ZwcBookMaker /transcode a.zwc_data b.zwc_data ... rewrites packages
+            // of GIF pages without the form, results go to the log.
+            if (args.Length > 0 && args[0].ToLower() == "/transcode")
+            {
+                Transcode(args.Skip(1));
+                return;
+            }
+
             Application.EnableVisualStyles();
             Application.SetCompatibleTextRenderingDefault(false);
             Application.Run(new Form1());
         }
+
+        static void Transcode(IEnumerable<string> packagePaths)
+        {
+            SettingsProvider buildConfig = new SettingsProvider();
+            buildConfig.LoadSettings(Path.Combine(Application.StartupPath, Form1.ConfigFileName));
+            LogHelper log = new LogHelper(Path.Combine(Application.StartupPath, "Log"));
+
+            foreach (string packagePath in packagePaths)
+            {
+                PackageTranscoder transcoder = new PackageTranscoder(Environment.ProcessorCount, buildConfig["Progressive"] == "True");
+                try
+                {
+                    transcoder.Transcode(packagePath);
+                    log.WriteLog(Path.GetFileName(packagePath) + Environment.NewLine + transcoder.GetStatistics());
+                }
+                catch (IOException ex)
+                {
+                    // Run again to resume, the next package goes on meanwhile.
+                    log.WriteLog(Path.GetFileName(packagePath) + Environment.NewLine + ex.Message);
+                }
+                catch (InvalidDataException ex)
+                {
+                    log.WriteLog(Path.GetFileName(packagePath) + Environment.NewLine + ex.Message);
+                }
+                catch (AggregateException ex)
+                {
+                    // A page the workers could not read, for example a corrupt GIF.
+                    log.WriteLog(Path.GetFileName(packagePath) + Environment.NewLine +
+                        string.Join(Environment.NewLine, ex.Flatten().InnerExceptions.Select(inner => inner.Message)));
+                }
+            }
+        }
     }
 }
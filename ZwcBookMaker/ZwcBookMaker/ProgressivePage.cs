@@ -0,0 +1,119 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Linq;
+using System.Text;
+using System.IO;
+
+namespace ZwcBookMaker
+{
+    /// <summary>
+    /// Page in two layers so the reader can show something at once while the
+    /// user flips fast: a coarse 1 bit base layer at the start of the blob and
+    /// the full 4 bit page after it, in any of the other page encodings.
+    ///
+    /// Layout: magic, [int base length], the base layer, the full page. The base
+    /// layer has one bit per baseScale x baseScale block, set when the block has
+    /// ink, rows of bits packed high bit first and PackBits compressed.
+    /// </summary>
+    public static class ProgressivePage
+    {
+        public static readonly byte[] PageMagic = Encoding.ASCII.GetBytes("ZPG1");
+
+        const int pageWidth = 600;
+        const int pageHeight = 800;
+        const int baseScale = 4;
+        const int baseWidth = pageWidth / baseScale;
+        const int baseHeight = pageHeight / baseScale;
+
+        // Levels under this are ink, and a block needs this many ink pixels of 16.
+        const int inkLevel = GrayQuantizer.LevelCount / 2;
+        const int blockInkPixels = 4;
+
+        /// <summary>
+        /// Put the base layer of a page, given as levels row by row, in front of its full encoding.
+        /// </summary>
+        public static byte[] Encode(byte[] levels, byte[] fullPage)
+        {
+            byte[] baseLayer = PackBits(BuildBaseLayer(levels));
+
+            MemoryStream page = new MemoryStream();
+            BinaryWriter writer = new BinaryWriter(page);
+            writer.Write(PageMagic);
+            writer.Write(baseLayer.Length);
+            writer.Write(baseLayer);
+            writer.Write(fullPage);
+            return page.ToArray();
+        }
+
+        static byte[] BuildBaseLayer(byte[] levels)
+        {
+            int rowBytes = (baseWidth + 7) / 8;
+            byte[] bits = new byte[rowBytes * baseHeight];
+            for (int blockY = 0; blockY < baseHeight; ++blockY)
+            {
+                for (int blockX = 0; blockX < baseWidth; ++blockX)
+                {
+                    int ink = 0;
+                    for (int y = blockY * baseScale; y < (blockY + 1) * baseScale; ++y)
+                    {
+                        int row = y * pageWidth;
+                        for (int x = blockX * baseScale; x < (blockX + 1) * baseScale; ++x)
+                        {
+                            if (levels[row + x] < inkLevel)
+                            {
+                                ++ink;
+                            }
+                        }
+                    }
+
+                    if (ink >= blockInkPixels)
+                    {
+                        bits[blockY * rowBytes + blockX / 8] |= (byte)(0x80 >> (blockX & 7));
+                    }
+                }
+            }
+            return bits;
+        }
+
+        /// <summary>
+        /// PackBits: a header n of 0 to 127 is followed by n + 1 literal bytes,
+        /// one of 129 to 255 by one byte repeated 257 - n times.
+        /// </summary>
+        static byte[] PackBits(byte[] data)
+        {
+            MemoryStream packed = new MemoryStream();
+            int start = 0;
+            while (start < data.Length)
+            {
+                int repeat = 1;
+                while (start + repeat < data.Length && repeat < 128 && data[start + repeat] == data[start])
+                {
+                    ++repeat;
+                }
+
+                if (repeat >= 3)
+                {
+                    packed.WriteByte((byte)(257 - repeat));
+                    packed.WriteByte(data[start]);
+                    start += repeat;
+                    continue;
+                }
+
+                // Literals up to the next run of three.
+                int end = start;
+                while (end < data.Length && end - start < 128)
+                {
+                    if (end + 2 < data.Length && data[end] == data[end + 1] && data[end] == data[end + 2])
+                    {
+                        break;
+                    }
+                    ++end;
+                }
+                packed.WriteByte((byte)(end - start - 1));
+                packed.Write(data, start, end - start);
+                start = end;
+            }
+            return packed.ToArray();
+        }
+    }
+}
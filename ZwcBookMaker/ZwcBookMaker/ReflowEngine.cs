@@ -0,0 +1,473 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Linq;
+using System.Text;
+using System.Drawing;
+using System.Drawing.Imaging;
+using System.IO;
+
+namespace ZwcBookMaker
+{
+    /// <summary>
+    /// Rebuilds paragraphs from the character boxes of the source pages and lays
+    /// them out again for the 600x800 screen. Pages are written as glyph runs
+    /// (position, size and text) which the reader draws with its own font, so
+    /// small print becomes readable and a page takes a few hundred bytes.
+    /// </summary>
+    public class ReflowEngine
+    {
+        public const int ScreenWidth = 600;
+        public const int ScreenHeight = 800;
+
+        /// <summary>
+        /// First bytes of a glyph run page, the reader uses them to tell it from a GIF page.
+        /// </summary>
+        public static readonly byte[] PageMagic = Encoding.ASCII.GetBytes("ZRF1");
+
+        const int margin = 24;
+        const int bodySize = 28;
+        const int headingSize = 38;
+        const double lineSpacing = 1.5;
+        const double paragraphSpacing = 0.4;
+        const byte headingFlag = 1;
+
+        // Chinese line breaking rules, these may not start or end a line.
+        const string lineStartProhibited = "，。、；：？！）」』】》〉〕”’…—～·%,.;:?!)]}";
+        const string lineEndProhibited = "（「『【《〈〔“‘([{";
+
+        class Line
+        {
+            public StringBuilder Text = new StringBuilder();
+            public double Left = double.MaxValue;
+            public double Right = double.MinValue;
+            public double Top = double.MinValue;
+            public double Bottom = double.MaxValue;
+            public double FontSizeSum = 0;
+            public int CharCount = 0;
+
+            public double FontSize
+            {
+                get
+                {
+                    return CharCount == 0 ? 0 : FontSizeSum / CharCount;
+                }
+            }
+        }
+
+        class Paragraph
+        {
+            public StringBuilder Text = new StringBuilder();
+            public bool IsHeading;
+            public double FontSize;
+        }
+
+        class Run
+        {
+            public int X;
+            public int Y;
+            public int Size;
+            public byte Flags;
+            public string Text;
+        }
+
+        string targetFolder;
+        int pageIndex = 1;
+        long outputBytes = 0;
+        int headingCount = 0;
+        GrayQuantizer quantizer = new GrayQuantizer();
+
+        List<Run> runs = new List<Run>();
+        int currentY = margin;
+
+        // The last paragraph of a source page may go on at the top of the next one.
+        Paragraph openParagraph = null;
+        bool openParagraphMayContinue = false;
+
+        public ReflowEngine(string targetFolder)
+        {
+            this.targetFolder = targetFolder;
+        }
+
+        /// <summary>
+        /// Reflow the text of a source page. Returns false if the page has no
+        /// usable text, the caller should add it with AddImagePage instead.
+        /// </summary>
+        public bool AddPage(PageText pageText)
+        {
+            List<Line> lines = BuildLines(pageText);
+            if (lines.Sum(line => line.CharCount) < 8)
+            {
+                return false;
+            }
+
+            double bodyFontSize = GetBodyFontSize(lines);
+            var bodyLines = lines.Where(line => Math.Abs(line.FontSize - bodyFontSize) < bodyFontSize * 0.15).ToList();
+            double textLeft = bodyLines.Min(line => line.Left);
+            double textRight = bodyLines.Max(line => line.Right);
+
+            Line previous = null;
+            foreach (var line in lines)
+            {
+                bool isHeading = line.FontSize >= bodyFontSize * 1.2;
+                bool startsParagraph;
+                if (previous == null)
+                {
+                    startsParagraph = openParagraph == null
+                        || !openParagraphMayContinue
+                        || isHeading != openParagraph.IsHeading
+                        || line.Left > textLeft + bodyFontSize * 1.2;
+                }
+                else
+                {
+                    startsParagraph = Math.Abs(line.FontSize - previous.FontSize) > bodyFontSize * 0.15
+                        || previous.Right < textRight - bodyFontSize * 1.5
+                        || line.Left > textLeft + bodyFontSize * 1.2
+                        || previous.Bottom - line.Top > Math.Max(line.FontSize, previous.FontSize) * 1.2;
+                }
+
+                if (startsParagraph)
+                {
+                    if (openParagraph != null)
+                    {
+                        LayoutParagraph(openParagraph);
+                    }
+
+                    openParagraph = new Paragraph();
+                    openParagraph.IsHeading = isHeading;
+                    openParagraph.FontSize = line.FontSize;
+                }
+
+                JoinLine(openParagraph.Text, line.Text.ToString());
+                previous = line;
+            }
+
+            openParagraphMayContinue = !openParagraph.IsHeading && previous.Right >= textRight - bodyFontSize * 1.5;
+            return true;
+        }
+
+        /// <summary>
+        /// A source page without text (figure or scan), scaled to fit the screen.
+        /// </summary>
+        public void AddImagePage(Bitmap bitmap)
+        {
+            if (openParagraph != null)
+            {
+                LayoutParagraph(openParagraph);
+                openParagraph = null;
+            }
+            SavePage();
+
+            double scale = Math.Min((double)ScreenWidth / bitmap.Width, (double)ScreenHeight / bitmap.Height);
+            int width = (int)(bitmap.Width * scale);
+            int height = (int)(bitmap.Height * scale);
+
+            using (Bitmap page = new Bitmap(ScreenWidth, ScreenHeight))
+            using (Graphics graphics = Graphics.FromImage(page))
+            {
+                graphics.Clear(Color.White);
+                graphics.DrawImage(bitmap, (ScreenWidth - width) / 2, (ScreenHeight - height) / 2, width, height);
+
+                string filePath = Path.Combine(targetFolder, string.Format("{0:D4}.gif", pageIndex));
+                using (Bitmap grayPage = quantizer.Quantize(page))
+                {
+                    grayPage.Save(filePath, ImageFormat.Gif);
+                }
+                outputBytes += new FileInfo(filePath).Length;
+                ++pageIndex;
+            }
+        }
+
+        public void Flush()
+        {
+            if (openParagraph != null)
+            {
+                LayoutParagraph(openParagraph);
+                openParagraph = null;
+            }
+            SavePage();
+        }
+
+        public int GetOutputPageCount()
+        {
+            return pageIndex - 1;
+        }
+
+        public long GetOutputBytes()
+        {
+            return outputBytes;
+        }
+
+        public int GetHeadingCount()
+        {
+            return headingCount;
+        }
+
+        List<Line> BuildLines(PageText pageText)
+        {
+            List<Line> lines = new List<Line>();
+            Line line = new Line();
+
+            for (int index = 0; index < pageText.Count; ++index)
+            {
+                char unicode = pageText.Unicode[index];
+                bool isGenerated = pageText.IsGenerated[index];
+                if (unicode == '\0')
+                {
+                    continue;
+                }
+
+                bool isBreak = unicode == '\r' || unicode == '\n';
+                if (!isBreak && !isGenerated && line.CharCount > 0)
+                {
+                    // The generated line breaks are not always there, check the geometry too.
+                    double middle = (pageText.Top[index] + pageText.Bottom[index]) / 2.0;
+                    isBreak = middle > line.Top || middle < line.Bottom;
+                }
+
+                if (isBreak)
+                {
+                    if (line.CharCount > 0)
+                    {
+                        lines.Add(line);
+                    }
+                    line = new Line();
+
+                    if (unicode == '\r' || unicode == '\n')
+                    {
+                        continue;
+                    }
+                }
+
+                if (char.IsWhiteSpace(unicode) || isGenerated)
+                {
+                    if (line.CharCount > 0)
+                    {
+                        line.Text.Append(' ');
+                    }
+                    continue;
+                }
+
+                line.Text.Append(unicode);
+                line.Left = Math.Min(line.Left, pageText.Left[index]);
+                line.Right = Math.Max(line.Right, pageText.Right[index]);
+                line.Top = Math.Max(line.Top, pageText.Top[index]);
+                line.Bottom = Math.Min(line.Bottom, pageText.Bottom[index]);
+                line.FontSizeSum += pageText.FontSize[index];
+                ++line.CharCount;
+            }
+
+            if (line.CharCount > 0)
+            {
+                lines.Add(line);
+            }
+
+            RemovePageDecorations(lines, pageText.Height);
+            return lines;
+        }
+
+        /// <summary>
+        /// Drop page numbers and running headers at the top and bottom of the page.
+        /// </summary>
+        void RemovePageDecorations(List<Line> lines, double pageHeight)
+        {
+            if (lines.Count < 3)
+            {
+                return;
+            }
+
+            double bodyFontSize = GetBodyFontSize(lines);
+            lines.RemoveAll(line =>
+            {
+                bool inMargin = line.Bottom > pageHeight * 0.92 || line.Top < pageHeight * 0.08;
+                string text = line.Text.ToString().Trim();
+                bool isPageNumber = text.All(c => char.IsDigit(c) || c == '-' || c == ' ');
+                return inMargin && (isPageNumber || line.FontSize < bodyFontSize * 0.9);
+            });
+        }
+
+        static double GetBodyFontSize(List<Line> lines)
+        {
+            // The size used by most characters, in half points.
+            return lines
+                .GroupBy(line => Math.Round(line.FontSize * 2) / 2)
+                .OrderByDescending(group => group.Sum(line => line.CharCount))
+                .First().Key;
+        }
+
+        static void JoinLine(StringBuilder text, string line)
+        {
+            line = line.Trim(' ', '　');
+            if (line.Length == 0)
+            {
+                return;
+            }
+
+            if (text.Length > 0)
+            {
+                char last = text[text.Length - 1];
+                char first = line[0];
+                if (last == '-' && text.Length > 1 && char.IsLetter(text[text.Length - 2]) && !IsWide(first))
+                {
+                    // Hyphenated word split over two lines.
+                    text.Length -= 1;
+                }
+                else if (!IsWide(last) && !IsWide(first))
+                {
+                    text.Append(' ');
+                }
+            }
+
+            text.Append(line);
+        }
+
+        static bool IsWide(char c)
+        {
+            return c >= '⺀';
+        }
+
+        static double GetWidth(char c, int size)
+        {
+            // SimSun: full width for CJK, half width for the rest.
+            return IsWide(c) ? size : size / 2.0;
+        }
+
+        void LayoutParagraph(Paragraph paragraph)
+        {
+            string text = paragraph.Text.ToString().Trim(' ', '　');
+            if (text.Length == 0)
+            {
+                return;
+            }
+
+            int size = paragraph.IsHeading ? headingSize : bodySize;
+            byte flags = paragraph.IsHeading ? headingFlag : (byte)0;
+            int lineHeight = (int)(size * lineSpacing);
+            double maxWidth = ScreenWidth - margin * 2;
+
+            if (paragraph.IsHeading)
+            {
+                ++headingCount;
+                if (currentY > margin)
+                {
+                    currentY += size / 2;
+                }
+            }
+
+            double indent = paragraph.IsHeading ? 0 : (IsWide(text[0]) ? size * 2 : size);
+            int lineStart = 0;
+            while (lineStart < text.Length)
+            {
+                int lineEnd = BreakLine(text, lineStart, maxWidth - indent, size);
+
+                if (currentY + lineHeight > ScreenHeight - margin)
+                {
+                    SavePage();
+                }
+
+                string lineText = text.Substring(lineStart, lineEnd - lineStart).TrimEnd(' ');
+                runs.Add(new Run()
+                {
+                    X = margin + (int)indent,
+                    Y = currentY,
+                    Size = size,
+                    Flags = flags,
+                    Text = lineText
+                });
+                currentY += lineHeight;
+
+                lineStart = lineEnd;
+                while (lineStart < text.Length && text[lineStart] == ' ')
+                {
+                    ++lineStart;
+                }
+                indent = 0;
+            }
+
+            currentY += (int)(size * paragraphSpacing);
+        }
+
+        /// <summary>
+        /// Find where the line starting at start ends. Breaks between CJK characters
+        /// or at spaces, a prohibited first character hangs in the margin and a
+        /// prohibited last character moves to the next line.
+        /// </summary>
+        static int BreakLine(string text, int start, double maxWidth, int size)
+        {
+            double width = 0;
+            int lastBreak = -1;
+            int index = start;
+            for (; index < text.Length; ++index)
+            {
+                char c = text[index];
+                if (index > start && (c == ' ' || IsWide(c) || IsWide(text[index - 1])))
+                {
+                    lastBreak = index;
+                }
+
+                width += GetWidth(c, size);
+                if (width > maxWidth && index > start)
+                {
+                    break;
+                }
+            }
+
+            if (index >= text.Length)
+            {
+                return text.Length;
+            }
+
+            // Hang closing punctuation at the end of this line.
+            if (lineStartProhibited.IndexOf(text[index]) >= 0)
+            {
+                return index + 1;
+            }
+
+            int end = IsWide(text[index]) || text[index] == ' ' || IsWide(text[index - 1]) ? index : lastBreak;
+            if (end <= start)
+            {
+                // A single word longer than the line.
+                end = index;
+            }
+
+            if (end - start > 1 && lineEndProhibited.IndexOf(text[end - 1]) >= 0)
+            {
+                --end;
+            }
+
+            return end;
+        }
+
+        void SavePage()
+        {
+            if (runs.Count == 0)
+            {
+                return;
+            }
+
+            string filePath = Path.Combine(targetFolder, string.Format("{0:D4}.zrf", pageIndex));
+            using (var writer = new BinaryWriter(File.Create(filePath)))
+            {
+                writer.Write(PageMagic);
+                writer.Write((ushort)runs.Count);
+                foreach (var run in runs)
+                {
+                    writer.Write((ushort)run.X);
+                    writer.Write((ushort)run.Y);
+                    writer.Write((byte)run.Size);
+                    writer.Write(run.Flags);
+                    writer.Write((ushort)run.Text.Length);
+                    foreach (char c in run.Text)
+                    {
+                        writer.Write((ushort)c);
+                    }
+                }
+
+                outputBytes += writer.BaseStream.Length;
+            }
+
+            ++pageIndex;
+            runs.Clear();
+            currentY = margin;
+        }
+    }
+}
@@ -0,0 +1,78 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Linq;
+using System.Text;
+using System.Diagnostics;
+using System.Drawing;
+using System.IO;
+using System.Windows.Forms;
+
+namespace ZwcBookMaker
+{
+    public class ReflowTest
+    {
+        public void Run()
+        {
+            string path = Path.Combine(Application.StartupPath, "人月神话.pdf");
+            string imageFolder = Path.Combine(Path.GetTempPath(), "ReflowTest_Image");
+            string reflowFolder = Path.Combine(Path.GetTempPath(), "ReflowTest_Reflow");
+            Directory.CreateDirectory(imageFolder);
+            Directory.CreateDirectory(reflowFolder);
+
+            using (var foxitPdf = new FoxitPDFSDK())
+            using (var pdfSource = new MappedPDFSource(path))
+            using (var reader = new FoxitPDFReader(pdfSource))
+            {
+                int pageCount = reader.GetPageCount();
+
+                var imageTime = Stopwatch.StartNew();
+                PageOutPutter outPutter = new PageOutPutter(imageFolder);
+                for (int pageIndex = 0; pageIndex < pageCount; ++pageIndex)
+                {
+                    using (Bitmap page = reader.RenderPage(pageIndex))
+                    {
+                        outPutter.AddPage(page);
+                    }
+                }
+                outPutter.Flush();
+                imageTime.Stop();
+
+                var reflowTime = Stopwatch.StartNew();
+                ReflowEngine reflowEngine = new ReflowEngine(reflowFolder);
+                PageText pageText = new PageText();
+                for (int pageIndex = 0; pageIndex < pageCount; ++pageIndex)
+                {
+                    reader.ExtractText(pageIndex, pageText);
+                    if (!reflowEngine.AddPage(pageText))
+                    {
+                        using (Bitmap page = reader.RenderPage(pageIndex))
+                        {
+                            reflowEngine.AddImagePage(page);
+                        }
+                    }
+                }
+                reflowEngine.Flush();
+                reflowTime.Stop();
+
+                // Headings found by the reflow engine stand in for chapters.
+                int chapterCount = Math.Max(1, reflowEngine.GetHeadingCount());
+                long imageBytes = new DirectoryInfo(imageFolder).GetFiles("*.gif").Sum(pageFile => pageFile.Length);
+
+                MessageBox.Show(string.Format(
+                    "{0} source pages, {1} headings\n" +
+                    "Image: {2} pages, {3:F1} per chapter, {4} KB, {5:F1} s\n" +
+                    "Reflow: {6} pages, {7:F1} per chapter, {8} KB, {9:F1} s",
+                    pageCount,
+                    chapterCount,
+                    outPutter.GetOutputPageCount(),
+                    (double)outPutter.GetOutputPageCount() / chapterCount,
+                    imageBytes / 1024,
+                    imageTime.Elapsed.TotalSeconds,
+                    reflowEngine.GetOutputPageCount(),
+                    (double)reflowEngine.GetOutputPageCount() / chapterCount,
+                    reflowEngine.GetOutputBytes() / 1024,
+                    reflowTime.Elapsed.TotalSeconds));
+            }
+        }
+    }
+}
@@ -0,0 +1,98 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Linq;
+using System.Text;
+
+namespace ZwcBookMaker
+{
+    /// <summary>
+    /// Bump allocator on the SDK heap for one reader. It only holds the
+    /// output bitmaps of a page, the SDK allocates its own working memory.
+    /// Everything allocated for a page is dropped together by Reset before the
+    /// next page. Allocate and Reset call the SDK heap, they are called with
+    /// FoxitPDFSDK.SyncRoot held.
+    /// </summary>
+    public class RenderArena : IDisposable
+    {
+        const int alignment = 16;
+
+        List<IntPtr> blocks = new List<IntPtr>();
+        long blockSize = 0;
+        long used = 0;
+        long pageUsed = 0;
+        long peakUsed = 0;
+
+        public void Dispose()
+        {
+            Release();
+        }
+
+        public IntPtr Allocate(long size)
+        {
+            size = (size + alignment - 1) / alignment * alignment;
+
+            if (blocks.Count == 0 || used + size > blockSize)
+            {
+                // Earlier allocations of this page stay valid, start another block.
+                long newBlockSize = Math.Max(size, blockSize);
+                IntPtr block = FoxitPDFSDK.FPDF_AllocMemory((uint)newBlockSize);
+                if (block == IntPtr.Zero)
+                {
+                    throw new OutOfMemoryException("Render arena allocation failed");
+                }
+
+                blocks.Add(block);
+                blockSize = newBlockSize;
+                used = 0;
+            }
+
+            IntPtr result = new IntPtr(blocks[blocks.Count - 1].ToInt64() + used);
+            used += size;
+            pageUsed += size;
+            peakUsed = Math.Max(peakUsed, pageUsed);
+
+            return result;
+        }
+
+        /// <summary>
+        /// Drop all allocations of the previous page. When the page needed more
+        /// than one block they are merged so the next page fits in one.
+        /// </summary>
+        public void Reset()
+        {
+            if (blocks.Count > 1)
+            {
+                long mergedSize = peakUsed;
+                Release();
+                blockSize = mergedSize;
+            }
+
+            used = 0;
+            pageUsed = 0;
+        }
+
+        /// <summary>
+        /// Give all memory back to the SDK heap.
+        /// </summary>
+        public void Release()
+        {
+            foreach (var block in blocks)
+            {
+                FoxitPDFSDK.FPDF_FreeMemory(block);
+            }
+
+            blocks.Clear();
+            blockSize = 0;
+            used = 0;
+            pageUsed = 0;
+        }
+
+        public long PeakUsed
+        {
+            get
+            {
+                return peakUsed;
+            }
+        }
+    }
+}
@@ -0,0 +1,192 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Linq;
+using System.Text;
+using System.Drawing;
+using System.Drawing.Imaging;
+using System.IO;
+using System.Security.Cryptography;
+using System.Threading;
+using System.Threading.Tasks;
+
+namespace ZwcBookMaker
+{
+    /// <summary>
+    /// On-disk cache of rendered source pages, keyed by the PDF content hash,
+    /// page index, the render options of the reader (see
+    /// FoxitPDFReader.GetRenderOptions) and the regions the page is rendered
+    /// as. Rebuilding a book with other slicing settings reads the pages back
+    /// instead of rendering.
+    /// </summary>
+    public class RenderCache
+    {
+        const int maxCachedRun = 16;
+
+        string cacheFolder;
+        string contentHash;
+        string renderOptions;
+        long maxBytes;
+        long totalBytes = 0;
+        object sizeLock = new object();
+
+        int hitCount = 0;
+        int missCount = 0;
+
+        public RenderCache(string cacheFolder, string pdfPath, string renderOptions, long maxBytes)
+        {
+            this.cacheFolder = cacheFolder;
+            this.renderOptions = renderOptions;
+            this.maxBytes = maxBytes;
+            Directory.CreateDirectory(cacheFolder);
+
+            using (var stream = File.OpenRead(pdfPath))
+            using (var sha1 = SHA1.Create())
+            {
+                contentHash = ToHex(sha1.ComputeHash(stream));
+            }
+
+            foreach (var cachedFile in new DirectoryInfo(cacheFolder).GetFiles("*.png"))
+            {
+                totalBytes += cachedFile.Length;
+            }
+        }
+
+        /// <summary>
+        /// Wrap a batch renderer: runs of cached pages are loaded from disk, the
+        /// rest is rendered and stored. The planner gives the regions of each page.
+        /// </summary>
+        public Func<int, Bitmap[]> Wrap(Func<int, Bitmap[]> renderBatch, PagePlanner planner, int pageCount)
+        {
+            return (pageIndex) =>
+            {
+                List<Bitmap> cachedPages = new List<Bitmap>();
+                while (cachedPages.Count < maxCachedRun && pageIndex + cachedPages.Count < pageCount)
+                {
+                    Bitmap cached = Load(GetPagePath(pageIndex + cachedPages.Count, planner));
+                    if (cached == null)
+                    {
+                        break;
+                    }
+                    cachedPages.Add(cached);
+                }
+
+                if (cachedPages.Count > 0)
+                {
+                    Interlocked.Add(ref hitCount, cachedPages.Count);
+                    return cachedPages.ToArray();
+                }
+
+                Bitmap[] pages = renderBatch(pageIndex);
+                Interlocked.Add(ref missCount, pages.Length);
+                string[] paths = Enumerable.Range(pageIndex, pages.Length).Select(index => GetPagePath(index, planner)).ToArray();
+                Parallel.For(0, pages.Length, (index) =>
+                {
+                    Store(paths[index], pages[index]);
+                });
+                Evict();
+
+                return pages;
+            };
+        }
+
+        string GetPagePath(int pageIndex, PagePlanner planner)
+        {
+            List<PageRegion> plan = planner.GetPlan(pageIndex);
+            string regions = plan == null ? "" : string.Join(";", plan.Select(region => string.Format("{0},{1},{2},{3},{4:R}",
+                region.Bounds.X, region.Bounds.Y, region.Bounds.Width, region.Bounds.Height, region.Scale)).ToArray());
+            string key = string.Format("{0}|{1}|{2}|{3}", contentHash, pageIndex, renderOptions, regions);
+            using (var sha1 = SHA1.Create())
+            {
+                return Path.Combine(cacheFolder, ToHex(sha1.ComputeHash(Encoding.UTF8.GetBytes(key))) + ".png");
+            }
+        }
+
+        Bitmap Load(string path)
+        {
+            if (!File.Exists(path))
+            {
+                return null;
+            }
+
+            try
+            {
+                // Copy out of the stream so the file is not kept open, in the
+                // format the renderer gives, PNG decodes to 32 bit ARGB.
+                Bitmap bitmap;
+                using (var stream = new MemoryStream(File.ReadAllBytes(path)))
+                using (var decoded = new Bitmap(stream))
+                {
+                    bitmap = decoded.Clone(new Rectangle(0, 0, decoded.Width, decoded.Height), PixelFormat.Format32bppRgb);
+                }
+
+                File.SetLastWriteTime(path, DateTime.Now);
+                return bitmap;
+            }
+            catch (Exception)
+            {
+                // A partly written or damaged entry, render the page again.
+                File.Delete(path);
+                return null;
+            }
+        }
+
+        void Store(string path, Bitmap page)
+        {
+            string tempPath = path + ".tmp";
+
+            page.Save(tempPath, ImageFormat.Png);
+            if (File.Exists(path))
+            {
+                File.Delete(path);
+            }
+            File.Move(tempPath, path);
+
+            lock (sizeLock)
+            {
+                totalBytes += new FileInfo(path).Length;
+            }
+        }
+
+        /// <summary>
+        /// Drop least recently used pages until the cache is below 90% of its limit.
+        /// </summary>
+        void Evict()
+        {
+            lock (sizeLock)
+            {
+                if (totalBytes <= maxBytes)
+                {
+                    return;
+                }
+
+                var files = new DirectoryInfo(cacheFolder).GetFiles("*.png").OrderBy(cachedFile => cachedFile.LastWriteTime);
+                foreach (var cachedFile in files)
+                {
+                    if (totalBytes <= maxBytes * 9 / 10)
+                    {
+                        break;
+                    }
+
+                    totalBytes -= cachedFile.Length;
+                    cachedFile.Delete();
+                }
+            }
+        }
+
+        static string ToHex(byte[] bytes)
+        {
+            return BitConverter.ToString(bytes).Replace("-", "").ToLower();
+        }
+
+        public string GetStatistics()
+        {
+            lock (sizeLock)
+            {
+                return string.Format("Render cache {0} hits, {1} misses, {2} MB on disk",
+                    hitCount,
+                    missCount,
+                    totalBytes / (1024 * 1024));
+            }
+        }
+    }
+}
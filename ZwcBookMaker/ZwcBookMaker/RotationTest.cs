@@ -0,0 +1,109 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Linq;
+using System.Text;
+using System.Diagnostics;
+using System.Drawing;
+using System.Drawing.Imaging;
+using System.IO;
+using System.Windows.Forms;
+
+namespace ZwcBookMaker
+{
+    public class RotationTest
+    {
+        const int repeatCount = 20;
+
+        public void Run()
+        {
+            string path = Path.Combine(Application.StartupPath, "人月神话.pdf");
+
+            using (var foxitPdf = new FoxitPDFSDK())
+            using (var pdfSource = new MappedPDFSource(path))
+            using (var reader = new FoxitPDFReader(pdfSource))
+            using (Bitmap rendered = reader.RenderPage(0))
+            using (Bitmap page = new Bitmap(rendered))
+            {
+                GrayQuantizer quantizer = new GrayQuantizer();
+
+                // In isolation: RotateFlip on its own, against what rotating adds
+                // to the gray pass of the quantizer.
+                var rotateFlip = Stopwatch.StartNew();
+                for (int run = 0; run < repeatCount; ++run)
+                {
+                    using (Bitmap copy = new Bitmap(page))
+                    {
+                        copy.RotateFlip(RotateFlipType.Rotate90FlipNone);
+                    }
+                }
+                rotateFlip.Stop();
+                var copyOnly = Stopwatch.StartNew();
+                for (int run = 0; run < repeatCount; ++run)
+                {
+                    using (Bitmap copy = new Bitmap(page))
+                    {
+                    }
+                }
+                copyOnly.Stop();
+
+                TimeSpan straight = TimeQuantize(quantizer, page, false);
+                TimeSpan turned = TimeQuantize(quantizer, page, true);
+
+                // Full pipeline, as SaveImage did before and does now.
+                var oldPipeline = Stopwatch.StartNew();
+                for (int run = 0; run < repeatCount; ++run)
+                {
+                    using (Bitmap copy = new Bitmap(page))
+                    {
+                        copy.RotateFlip(RotateFlipType.Rotate90FlipNone);
+                        SaveGif(quantizer.Quantize(copy, DitherMode.Ordered));
+                    }
+                }
+                oldPipeline.Stop();
+                var newPipeline = Stopwatch.StartNew();
+                for (int run = 0; run < repeatCount; ++run)
+                {
+                    using (Bitmap copy = new Bitmap(page))
+                    {
+                        SaveGif(quantizer.Quantize(copy, DitherMode.Ordered, true));
+                    }
+                }
+                newPipeline.Stop();
+
+                MessageBox.Show(string.Format(
+                    "{0}x{1} page, per page:\n" +
+                    "RotateFlip: {2:F2} ms\n" +
+                    "Fused rotation: {3:F2} ms\n" +
+                    "Rotate, quantize and save: {4:F2} ms\n" +
+                    "Fused quantize and save: {5:F2} ms",
+                    page.Width,
+                    page.Height,
+                    (rotateFlip.Elapsed - copyOnly.Elapsed).TotalMilliseconds / repeatCount,
+                    (turned - straight).TotalMilliseconds / repeatCount,
+                    oldPipeline.Elapsed.TotalMilliseconds / repeatCount,
+                    newPipeline.Elapsed.TotalMilliseconds / repeatCount));
+            }
+        }
+
+        static TimeSpan TimeQuantize(GrayQuantizer quantizer, Bitmap page, bool rotate)
+        {
+            var time = Stopwatch.StartNew();
+            for (int run = 0; run < repeatCount; ++run)
+            {
+                using (Bitmap quantized = quantizer.Quantize(page, DitherMode.None, rotate))
+                {
+                }
+            }
+            return time.Elapsed;
+        }
+
+        static void SaveGif(Bitmap quantized)
+        {
+            using (quantized)
+            using (MemoryStream stream = new MemoryStream())
+            {
+                quantized.Save(stream, ImageFormat.Gif);
+            }
+        }
+    }
+}
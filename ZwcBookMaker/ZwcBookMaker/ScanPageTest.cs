@@ -0,0 +1,53 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Linq;
+using System.Text;
+using System.Diagnostics;
+using System.Drawing;
+using System.IO;
+using System.Windows.Forms;
+
+namespace ZwcBookMaker
+{
+    public class ScanPageTest
+    {
+        const int pageCount = 50;
+
+        public void Run()
+        {
+            string path = Path.Combine(Application.StartupPath, "扫描版.pdf");
+
+            using (var foxitPdf = new FoxitPDFSDK())
+            using (var pdfSource = new MappedPDFSource(path))
+            using (var reader = new FoxitPDFReader(pdfSource))
+            {
+                int count = Math.Min(pageCount, reader.GetPageCount());
+
+                reader.ExtractScans = false;
+                TimeSpan rendered = TimePages(reader, count);
+
+                reader.ExtractScans = true;
+                TimeSpan extracted = TimePages(reader, count);
+
+                MessageBox.Show(string.Format(
+                    "{0} pages, per page: {1:F1} ms rendered, {2:F1} ms extracted, {3:F1}x faster",
+                    count,
+                    rendered.TotalMilliseconds / count,
+                    extracted.TotalMilliseconds / count,
+                    rendered.TotalMilliseconds / Math.Max(1, extracted.TotalMilliseconds)));
+            }
+        }
+
+        static TimeSpan TimePages(FoxitPDFReader reader, int count)
+        {
+            var time = Stopwatch.StartNew();
+            for (int pageIndex = 0; pageIndex < count; ++pageIndex)
+            {
+                using (Bitmap page = reader.RenderPage(pageIndex))
+                {
+                }
+            }
+            return time.Elapsed;
+        }
+    }
+}
@@ -0,0 +1,228 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Linq;
+using System.Text;
+using System.IO;
+using System.Drawing;
+
+namespace ZwcBookMaker
+{
+    /// <summary>
+    /// Inverted index from terms to the output pages they appear on. CJK text
+    /// is indexed as overlapping bigrams and as single characters, so a one
+    /// character query finds it in either place of a bigram. Latin text is
+    /// indexed as lower case words.
+    ///
+    /// Section layout:
+    ///   int termCount
+    ///   (termCount + 1) x [int termOffset][int postingsOffset], sorted by term
+    ///   term characters, UTF-16LE
+    ///   postings, output page numbers as delta varints
+    /// The last entry only marks where the term characters and postings end.
+    /// </summary>
+    public class SearchIndexBuilder : IPackageSection
+    {
+        public const string SectionTag = "SRCH";
+        public const int MaxWordLength = 32;
+
+        // Per term the source page (high 32 bits), line x (16 bits) and line y (low 16 bits) of each occurrence.
+        Dictionary<string, List<long>> occurrences = new Dictionary<string, List<long>>();
+        int sectionBytes = 0;
+
+        public string Tag
+        {
+            get
+            {
+                return SectionTag;
+            }
+        }
+
+        public void AddSourcePage(FoxitPDFReader textReader, PageText pageText)
+        {
+            int sourcePageIndex = pageText.PageIndex;
+            string text = new string(pageText.Unicode, 0, pageText.Count);
+
+            // The start of the line each character is on, one box per line is
+            // enough to find the output page.
+            Point[] lineStarts = new Point[text.Length];
+            bool lineStart = true;
+            Point start = Point.Empty;
+            for (int index = 0; index < text.Length; ++index)
+            {
+                if (text[index] == '\n')
+                {
+                    lineStart = true;
+                }
+                else if (lineStart && !pageText.IsGenerated[index] && !char.IsWhiteSpace(text[index]))
+                {
+                    start = pageText.GetPixelBox(index).Location;
+                    lineStart = false;
+                }
+                lineStarts[index] = start;
+            }
+
+            Tokenize(text, (term, index) =>
+            {
+                Point line = lineStarts[index];
+                long occurrence = ((long)sourcePageIndex << 32) | ((long)(ushort)Math.Max(line.X, 0) << 16) | (ushort)Math.Max(line.Y, 0);
+
+                List<long> termOccurrences;
+                if (!occurrences.TryGetValue(term, out termOccurrences))
+                {
+                    termOccurrences = new List<long>();
+                    occurrences[term] = termOccurrences;
+                }
+
+                if (termOccurrences.Count == 0 || termOccurrences[termOccurrences.Count - 1] != occurrence)
+                {
+                    termOccurrences.Add(occurrence);
+                }
+            });
+        }
+
+        public byte[] Build(FoxitPDFReader textReader, PageOutPutter outPutter)
+        {
+            List<string> terms = occurrences.Keys.ToList();
+            terms.Sort(string.CompareOrdinal);
+
+            MemoryStream termChars = new MemoryStream();
+            MemoryStream postings = new MemoryStream();
+            List<int> termOffsets = new List<int>();
+            List<int> postingsOffsets = new List<int>();
+
+            foreach (var term in terms)
+            {
+                termOffsets.Add((int)termChars.Length / 2);
+                postingsOffsets.Add((int)postings.Length);
+
+                byte[] termBytes = Encoding.Unicode.GetBytes(term);
+                termChars.Write(termBytes, 0, termBytes.Length);
+
+                var pages = occurrences[term]
+                    .Select(occurrence => outPutter.GetOutputPageIndex((int)(occurrence >> 32), (int)((occurrence >> 16) & 0xFFFF), (int)(occurrence & 0xFFFF)))
+                    .Distinct()
+                    .OrderBy(page => page);
+
+                int previousPage = 0;
+                foreach (int page in pages)
+                {
+                    WriteVarint(postings, page - previousPage);
+                    previousPage = page;
+                }
+            }
+
+            termOffsets.Add((int)termChars.Length / 2);
+            postingsOffsets.Add((int)postings.Length);
+
+            MemoryStream section = new MemoryStream();
+            using (BinaryWriter writer = new BinaryWriter(section))
+            {
+                writer.Write(terms.Count);
+                for (int index = 0; index <= terms.Count; ++index)
+                {
+                    writer.Write(termOffsets[index]);
+                    writer.Write(postingsOffsets[index]);
+                }
+                writer.Write(termChars.ToArray());
+                writer.Write(postings.ToArray());
+            }
+
+            byte[] result = section.ToArray();
+            sectionBytes = result.Length;
+            return result;
+        }
+
+        /// <summary>
+        /// Split text into index terms, addTerm gets each term and the index of
+        /// its first character. The reader splits queries the same way.
+        /// </summary>
+        public static void Tokenize(string text, Action<string, int> addTerm)
+        {
+            int index = 0;
+            while (index < text.Length)
+            {
+                char c = Normalize(text[index]);
+                if (IsCjk(c))
+                {
+                    // A line break inside CJK text does not end the word.
+                    List<int> positions = new List<int>();
+                    for (; index < text.Length; ++index)
+                    {
+                        char current = Normalize(text[index]);
+                        if (current == '\r' || current == '\n')
+                        {
+                            continue;
+                        }
+                        if (!IsCjk(current))
+                        {
+                            break;
+                        }
+                        positions.Add(index);
+                    }
+
+                    foreach (int position in positions)
+                    {
+                        addTerm(text[position].ToString(), position);
+                    }
+                    for (int i = 0; i + 1 < positions.Count; ++i)
+                    {
+                        addTerm(new string(new char[] { text[positions[i]], text[positions[i + 1]] }), positions[i]);
+                    }
+                }
+                else if (char.IsLetterOrDigit(c))
+                {
+                    int start = index;
+                    StringBuilder word = new StringBuilder();
+                    for (; index < text.Length; ++index)
+                    {
+                        char current = Normalize(text[index]);
+                        if (!char.IsLetterOrDigit(current) || IsCjk(current))
+                        {
+                            break;
+                        }
+                        if (word.Length < MaxWordLength)
+                        {
+                            word.Append(current);
+                        }
+                    }
+
+                    addTerm(word.ToString(), start);
+                }
+                else
+                {
+                    ++index;
+                }
+            }
+        }
+
+        static char Normalize(char c)
+        {
+            // Full width ASCII to ASCII.
+            if (c >= '！' && c <= '～')
+            {
+                c = (char)(c - 0xFEE0);
+            }
+            return char.ToLower(c);
+        }
+
+        static bool IsCjk(char c)
+        {
+            return c >= '⺀' && char.IsLetterOrDigit(c);
+        }
+
+        static void WriteVarint(Stream stream, int value)
+        {
+            while (value >= 0x80)
+            {
+                stream.WriteByte((byte)(value | 0x80));
+                value >>= 7;
+            }
+            stream.WriteByte((byte)value);
+        }
+
+        public string GetStatistics()
+        {
+            return string.Format("Search index {0} terms, {1} KB", occurrences.Count, sectionBytes / 1024);
+        }
+    }
+}
@@ -0,0 +1,758 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Linq;
+using System.Text;
+using System.Drawing;
+using System.Drawing.Imaging;
+using System.IO;
+
+namespace ZwcBookMaker
+{
+    /// <summary>
+    /// Symbol matching for image pages, after JBIG2. The connected components
+    /// of ink on every page of the book are collected, those found more than
+    /// once go to one dictionary in the SYMB section, and a page becomes the
+    /// list of symbols placed on it plus a residual of raw levels for the ink
+    /// no symbol covers. Components are matched on their shape, the pixels
+    /// darker than mid gray, so anti-aliased and dithered copies of a glyph
+    /// find the same symbol when few pixels differ. Every pixel the placed
+    /// symbols get wrong goes to the residual, so pages stay lossless.
+    ///
+    /// Section: [int count] and per symbol [byte width][byte height][levels,
+    /// two per byte, row by row]. Page: magic, [varint count] and per symbol
+    /// [varint dy][zigzag varint dx][varint index] in row order, then [varint
+    /// count] and per residual run [varint skip][varint length][levels, two
+    /// per byte]. Runs count pixels row by row over the whole page.
+    /// </summary>
+    public class SymbolCodec
+    {
+        public const string SectionTag = "SYMB";
+        public static readonly byte[] PageMagic = Encoding.ASCII.GetBytes("ZSY1");
+
+        const int pageWidth = 600;
+        const int pageHeight = 800;
+        const byte white = GrayQuantizer.LevelCount - 1;
+
+        // Larger components are figures or dithered gray, left to the residual.
+        const int maxSymbolSize = 64;
+
+        // A symbol found once costs more in the dictionary than in the residual.
+        const int minUseCount = 2;
+
+        // Levels below this are ink in the shape of a component.
+        const byte inkLevel = 8;
+
+        // Shapes match when at most one pixel in this many of the box differs.
+        const int mismatchShare = 32;
+
+        // Bound the first pass table, singletons are dropped when it is full.
+        // Each codec of a parallel first pass has its own table, so they only
+        // give the same dictionary as one codec while under this.
+        const int maxShapeCount = 8192;
+
+        // Most used symbols kept, indices stay within two varint bytes.
+        const int maxDictionarySize = 4096;
+
+        // Residual runs closer than this are joined, the pixels between are
+        // written with their own levels.
+        const int maxResidualGap = 4;
+
+        class Symbol
+        {
+            public int Width;
+            public int Height;
+            public byte[] Levels;
+            public ulong[] Shape;
+            public int InkCount;
+            public int UseCount;
+            public int Index = -1;
+        }
+
+        class Placement
+        {
+            public int X;
+            public int Y;
+            public int Index;
+        }
+
+        // First pass, distinct shapes by hash and in the order they were found.
+        Dictionary<ulong, List<Symbol>> shapes = new Dictionary<ulong, List<Symbol>>();
+        List<Symbol> shapeOrder = new List<Symbol>();
+
+        // Dictionary symbols by width << 8 | height.
+        Dictionary<int, List<Symbol>> symbolsBySize = new Dictionary<int, List<Symbol>>();
+        List<Symbol> dictionary = new List<Symbol>();
+
+        // Reused from page to page.
+        byte[] levels = new byte[pageWidth * pageHeight];
+        bool[] visited = new bool[pageWidth * pageHeight];
+        bool[] residual = new bool[pageWidth * pageHeight];
+        byte[] placed = new byte[pageWidth * pageHeight];
+        int[] component = new int[pageWidth * pageHeight];
+        int[] stack = new int[pageWidth * pageHeight];
+
+        int encodedPageCount = 0;
+        int skippedPageCount = 0;
+        long placementCount = 0;
+        long correctedPixelCount = 0;
+
+        public int EncodedPageCount
+        {
+            get
+            {
+                return encodedPageCount;
+            }
+        }
+
+        public static bool IsSymbolPage(byte[] content)
+        {
+            return content.Length >= PageMagic.Length && content.Take(PageMagic.Length).SequenceEqual(PageMagic);
+        }
+
+        /// <summary>
+        /// First pass, count the symbols of a GIF page from PageOutPutter.
+        /// </summary>
+        public void AddPage(byte[] gif)
+        {
+            if (!ReadLevels(gif))
+            {
+                return;
+            }
+
+            ForEachComponent((left, top, right, bottom, pixelCount) =>
+            {
+                Symbol symbol = GetComponent(left, top, right, bottom, pixelCount);
+                if (symbol != null)
+                {
+                    AddShape(symbol, 1);
+                }
+            });
+        }
+
+        /// <summary>
+        /// Add the symbol counts of a codec that ran the first pass over other
+        /// pages, so the first pass can be split between threads.
+        /// </summary>
+        public void Merge(SymbolCodec other)
+        {
+            foreach (var symbol in other.shapeOrder)
+            {
+                AddShape(new Symbol() { Width = symbol.Width, Height = symbol.Height, Levels = symbol.Levels, Shape = symbol.Shape, InkCount = symbol.InkCount }, symbol.UseCount);
+            }
+        }
+
+        /// <summary>
+        /// Take the dictionary of a section from BuildDictionary instead of running
+        /// the first pass, pages are then coded as by the codec that built it.
+        /// </summary>
+        public void LoadDictionary(byte[] section)
+        {
+            shapes.Clear();
+            shapeOrder.Clear();
+            symbolsBySize.Clear();
+            dictionary = new List<Symbol>();
+
+            int count = BitConverter.ToInt32(section, 0);
+            int offset = 4;
+            for (int index = 0; index < count; ++index)
+            {
+                int width = section[offset];
+                int height = section[offset + 1];
+                offset += 2;
+
+                byte[] symbolLevels = new byte[width * height];
+                for (int pixel = 0; pixel < symbolLevels.Length; ++pixel)
+                {
+                    byte packed = section[offset + pixel / 2];
+                    symbolLevels[pixel] = (byte)((pixel & 1) == 0 ? packed >> 4 : packed & 0xF);
+                }
+                offset += (symbolLevels.Length + 1) / 2;
+
+                Symbol symbol = CreateSymbol(symbolLevels, width, height);
+                symbol.Index = index;
+                dictionary.Add(symbol);
+                AddBySize(symbol);
+            }
+        }
+
+        /// <summary>
+        /// After the first pass, number the symbols found often enough, the most
+        /// used first so they get the shortest indices. Going from the most used
+        /// shape down, a shape close to one already taken adds its count to it.
+        /// Returns the section.
+        /// </summary>
+        public byte[] BuildDictionary()
+        {
+            symbolsBySize.Clear();
+            List<Symbol> taken = new List<Symbol>();
+            foreach (var shape in shapeOrder.OrderByDescending(shape => shape.UseCount).ToList())
+            {
+                Symbol match = FindNearest(shape.Shape, shape.InkCount, shape.Width, shape.Height);
+                if (match != null)
+                {
+                    match.UseCount += shape.UseCount;
+                }
+                else
+                {
+                    taken.Add(shape);
+                    AddBySize(shape);
+                }
+            }
+
+            dictionary = taken
+                .Where(symbol => symbol.UseCount >= minUseCount)
+                .OrderByDescending(symbol => symbol.UseCount)
+                .Take(maxDictionarySize)
+                .ToList();
+
+            // The second pass only looks up dictionary symbols.
+            shapes.Clear();
+            shapeOrder.Clear();
+            symbolsBySize.Clear();
+            foreach (var symbol in dictionary)
+            {
+                AddBySize(symbol);
+            }
+
+            MemoryStream section = new MemoryStream();
+            BinaryWriter writer = new BinaryWriter(section);
+            writer.Write(dictionary.Count);
+            for (int index = 0; index < dictionary.Count; ++index)
+            {
+                Symbol symbol = dictionary[index];
+                symbol.Index = index;
+                writer.Write((byte)symbol.Width);
+                writer.Write((byte)symbol.Height);
+                WriteLevels(writer, symbol.Levels, 0, symbol.Levels.Length);
+            }
+
+            return section.ToArray();
+        }
+
+        /// <summary>
+        /// Second pass, a GIF page as symbols and residual. Null when that is
+        /// not smaller than the GIF, for example on pages of pictures.
+        /// </summary>
+        public byte[] EncodePage(byte[] gif)
+        {
+            if (!ReadLevels(gif))
+            {
+                return null;
+            }
+
+            List<Placement> placements = new List<Placement>();
+            for (int pixel = 0; pixel < placed.Length; ++pixel)
+            {
+                placed[pixel] = white;
+            }
+            ForEachComponent((left, top, right, bottom, pixelCount) =>
+            {
+                Symbol found = GetComponent(left, top, right, bottom, pixelCount);
+                Symbol symbol = found != null ? FindNearest(found.Shape, found.InkCount, found.Width, found.Height) : null;
+                if (symbol == null || !IsWorthPlacing(symbol, found, pixelCount))
+                {
+                    return;
+                }
+
+                placements.Add(new Placement() { X = left, Y = top, Index = symbol.Index });
+                for (int row = 0; row < symbol.Height; ++row)
+                {
+                    int target = (top + row) * pageWidth + left;
+                    int source = row * symbol.Width;
+                    for (int column = 0; column < symbol.Width; ++column)
+                    {
+                        placed[target + column] = Math.Min(placed[target + column], symbol.Levels[source + column]);
+                    }
+                }
+            });
+
+            // Whatever the symbols did not draw exactly, ink they missed and
+            // levels they got wrong, is written as it is.
+            int correctedPixels = 0;
+            for (int pixel = 0; pixel < residual.Length; ++pixel)
+            {
+                residual[pixel] = placed[pixel] != levels[pixel];
+                if (residual[pixel] && placed[pixel] != white)
+                {
+                    ++correctedPixels;
+                }
+            }
+
+            MemoryStream page = new MemoryStream();
+            BinaryWriter writer = new BinaryWriter(page);
+            writer.Write(PageMagic);
+
+            WriteVarint(writer, placements.Count);
+            int x = 0;
+            int y = 0;
+            foreach (var placement in placements.OrderBy(placement => placement.Y).ThenBy(placement => placement.X))
+            {
+                WriteVarint(writer, placement.Y - y);
+                WriteVarint(writer, ZigZag(placement.X - x));
+                WriteVarint(writer, placement.Index);
+                x = placement.X;
+                y = placement.Y;
+            }
+
+            List<int[]> runs = FindResidualRuns();
+            WriteVarint(writer, runs.Count);
+            int end = 0;
+            foreach (int[] run in runs)
+            {
+                WriteVarint(writer, run[0] - end);
+                WriteVarint(writer, run[1] - run[0]);
+                WriteLevels(writer, levels, run[0], run[1] - run[0]);
+                end = run[1];
+            }
+
+            if (page.Length >= gif.Length)
+            {
+                ++skippedPageCount;
+                return null;
+            }
+
+            ++encodedPageCount;
+            placementCount += placements.Count;
+            correctedPixelCount += correctedPixels;
+            return page.ToArray();
+        }
+
+        /// <summary>
+        /// Levels of a page written by EncodePage, row by row, as the reader rebuilds it.
+        /// </summary>
+        public byte[] DecodePage(byte[] content)
+        {
+            byte[] page = Enumerable.Repeat(white, pageWidth * pageHeight).ToArray();
+            int offset = PageMagic.Length;
+
+            int count = ReadVarint(content, ref offset);
+            int x = 0;
+            int y = 0;
+            for (int i = 0; i < count; ++i)
+            {
+                y += ReadVarint(content, ref offset);
+                int dx = ReadVarint(content, ref offset);
+                x += (dx >> 1) ^ -(dx & 1);
+                Symbol symbol = dictionary[ReadVarint(content, ref offset)];
+
+                for (int row = 0; row < symbol.Height; ++row)
+                {
+                    int target = (y + row) * pageWidth + x;
+                    int source = row * symbol.Width;
+                    for (int column = 0; column < symbol.Width; ++column)
+                    {
+                        byte level = symbol.Levels[source + column];
+                        if (level < page[target + column])
+                        {
+                            page[target + column] = level;
+                        }
+                    }
+                }
+            }
+
+            int runCount = ReadVarint(content, ref offset);
+            int position = 0;
+            for (int i = 0; i < runCount; ++i)
+            {
+                position += ReadVarint(content, ref offset);
+                int length = ReadVarint(content, ref offset);
+                for (int pixel = 0; pixel < length; ++pixel, ++position)
+                {
+                    byte packed = content[offset + pixel / 2];
+                    page[position] = (byte)((pixel & 1) == 0 ? packed >> 4 : packed & 0xF);
+                }
+                offset += (length + 1) / 2;
+            }
+
+            return page;
+        }
+
+        /// <summary>
+        /// Levels of a GIF page row by row, null for any other image. The buffer
+        /// is reused by the next call.
+        /// </summary>
+        public byte[] ReadPage(byte[] gif)
+        {
+            return ReadLevels(gif) ? levels : null;
+        }
+
+        /// <summary>
+        /// Levels of a 4 bit gray GIF into the levels buffer, false for any other
+        /// image. Only the palette GrayQuantizer writes is read as levels, older
+        /// pages were saved with the GDI+ halftone palette and would lose detail.
+        /// </summary>
+        unsafe bool ReadLevels(byte[] gif)
+        {
+            using (Bitmap image = new Bitmap(new MemoryStream(gif)))
+            {
+                bool isIndexed = image.PixelFormat == PixelFormat.Format8bppIndexed || image.PixelFormat == PixelFormat.Format4bppIndexed;
+                if (image.Width != pageWidth || image.Height != pageHeight || !isIndexed)
+                {
+                    return false;
+                }
+
+                // Palette index to level, GIF decoders may reorder the palette.
+                Color[] palette = image.Palette.Entries;
+                if (palette.Length != GrayQuantizer.LevelCount)
+                {
+                    return false;
+                }
+
+                byte[] levelOf = new byte[256];
+                bool[] isLevelUsed = new bool[GrayQuantizer.LevelCount];
+                for (int index = 0; index < palette.Length; ++index)
+                {
+                    Color color = palette[index];
+                    int level = color.R / GrayQuantizer.LevelStep;
+                    if (color.G != color.R || color.B != color.R || color.R % GrayQuantizer.LevelStep != 0 || isLevelUsed[level])
+                    {
+                        return false;
+                    }
+
+                    isLevelUsed[level] = true;
+                    levelOf[index] = (byte)level;
+                }
+
+                BitmapData data = image.LockBits(new Rectangle(0, 0, pageWidth, pageHeight), ImageLockMode.ReadOnly, image.PixelFormat);
+                try
+                {
+                    bool isPacked = image.PixelFormat == PixelFormat.Format4bppIndexed;
+                    for (int y = 0; y < pageHeight; ++y)
+                    {
+                        byte* row = (byte*)data.Scan0 + (long)y * data.Stride;
+                        int target = y * pageWidth;
+                        for (int x = 0; x < pageWidth; ++x)
+                        {
+                            int index = isPacked ? ((x & 1) == 0 ? row[x >> 1] >> 4 : row[x >> 1] & 0xF) : row[x];
+                            levels[target + x] = levelOf[index];
+                        }
+                    }
+                }
+                finally
+                {
+                    image.UnlockBits(data);
+                }
+            }
+
+            return true;
+        }
+
+        /// <summary>
+        /// Call found with the box [left, right) x [top, bottom) and pixel count of
+        /// each 8-connected component of ink. Its pixels are the first entries of
+        /// component until the next call.
+        /// </summary>
+        void ForEachComponent(Action<int, int, int, int, int> found)
+        {
+            Array.Clear(visited, 0, visited.Length);
+            for (int start = 0; start < levels.Length; ++start)
+            {
+                if (visited[start] || levels[start] == white)
+                {
+                    continue;
+                }
+
+                int left = pageWidth, top = pageHeight, right = 0, bottom = 0;
+                int pixelCount = 0;
+                int stackCount = 0;
+                stack[stackCount++] = start;
+                visited[start] = true;
+
+                while (stackCount > 0)
+                {
+                    int pixel = stack[--stackCount];
+                    component[pixelCount++] = pixel;
+
+                    int x = pixel % pageWidth;
+                    int y = pixel / pageWidth;
+                    left = Math.Min(left, x);
+                    right = Math.Max(right, x + 1);
+                    top = Math.Min(top, y);
+                    bottom = Math.Max(bottom, y + 1);
+
+                    for (int neighbourY = Math.Max(0, y - 1); neighbourY <= Math.Min(pageHeight - 1, y + 1); ++neighbourY)
+                    {
+                        for (int neighbourX = Math.Max(0, x - 1); neighbourX <= Math.Min(pageWidth - 1, x + 1); ++neighbourX)
+                        {
+                            int neighbour = neighbourY * pageWidth + neighbourX;
+                            if (!visited[neighbour] && levels[neighbour] != white)
+                            {
+                                visited[neighbour] = true;
+                                stack[stackCount++] = neighbour;
+                            }
+                        }
+                    }
+                }
+
+                found(left, top, right, bottom, pixelCount);
+            }
+        }
+
+        /// <summary>
+        /// The component just found as a symbol that is not in any table yet.
+        /// Null for components too large to be symbols or without a shape.
+        /// </summary>
+        Symbol GetComponent(int left, int top, int right, int bottom, int pixelCount)
+        {
+            int width = right - left;
+            int height = bottom - top;
+            if (width > maxSymbolSize || height > maxSymbolSize)
+            {
+                return null;
+            }
+
+            // Other components inside the box are left out of the symbol.
+            byte[] symbolLevels = Enumerable.Repeat(white, width * height).ToArray();
+            for (int i = 0; i < pixelCount; ++i)
+            {
+                int pixel = component[i];
+                symbolLevels[(pixel / pageWidth - top) * width + pixel % pageWidth - left] = levels[pixel];
+            }
+
+            Symbol symbol = CreateSymbol(symbolLevels, width, height);
+            return symbol.InkCount > 0 ? symbol : null;
+        }
+
+        static Symbol CreateSymbol(byte[] symbolLevels, int width, int height)
+        {
+            ulong[] shape = new ulong[(symbolLevels.Length + 63) / 64];
+            int inkCount = 0;
+            for (int pixel = 0; pixel < symbolLevels.Length; ++pixel)
+            {
+                if (symbolLevels[pixel] < inkLevel)
+                {
+                    shape[pixel >> 6] |= 1UL << (pixel & 63);
+                    ++inkCount;
+                }
+            }
+
+            return new Symbol() { Width = width, Height = height, Levels = symbolLevels, Shape = shape, InkCount = inkCount };
+        }
+
+        /// <summary>
+        /// First pass, count a shape. Only the same shape is counted together
+        /// here, close shapes are joined by BuildDictionary in a fixed order.
+        /// </summary>
+        void AddShape(Symbol symbol, int useCount)
+        {
+            ulong hash = HashShape(symbol);
+            List<Symbol> candidates;
+            if (shapes.TryGetValue(hash, out candidates))
+            {
+                foreach (var candidate in candidates)
+                {
+                    if (candidate.Width == symbol.Width && candidate.Height == symbol.Height && candidate.Shape.SequenceEqual(symbol.Shape))
+                    {
+                        candidate.UseCount += useCount;
+                        return;
+                    }
+                }
+            }
+
+            if (shapeOrder.Count >= maxShapeCount)
+            {
+                DropSingleShapes();
+                if (shapeOrder.Count >= maxShapeCount)
+                {
+                    return;
+                }
+                shapes.TryGetValue(hash, out candidates);
+            }
+
+            if (candidates == null)
+            {
+                candidates = new List<Symbol>();
+                shapes[hash] = candidates;
+            }
+
+            symbol.UseCount = useCount;
+            candidates.Add(symbol);
+            shapeOrder.Add(symbol);
+        }
+
+        void DropSingleShapes()
+        {
+            shapeOrder.RemoveAll(symbol => symbol.UseCount < minUseCount);
+            shapes.Clear();
+            foreach (var symbol in shapeOrder)
+            {
+                ulong hash = HashShape(symbol);
+                List<Symbol> candidates;
+                if (!shapes.TryGetValue(hash, out candidates))
+                {
+                    candidates = new List<Symbol>();
+                    shapes[hash] = candidates;
+                }
+                candidates.Add(symbol);
+            }
+        }
+
+        static ulong HashShape(Symbol symbol)
+        {
+            ulong hash = (ulong)(symbol.Width << 8 | symbol.Height);
+            foreach (ulong bits in symbol.Shape)
+            {
+                hash = (hash ^ bits) * 0x100000001B3UL;
+                hash ^= hash >> 29;
+            }
+            return hash;
+        }
+
+        void AddBySize(Symbol symbol)
+        {
+            int size = symbol.Width << 8 | symbol.Height;
+            List<Symbol> candidates;
+            if (!symbolsBySize.TryGetValue(size, out candidates))
+            {
+                candidates = new List<Symbol>();
+                symbolsBySize[size] = candidates;
+            }
+            candidates.Add(symbol);
+        }
+
+        /// <summary>
+        /// The symbol of the same size whose shape differs in the fewest pixels,
+        /// null when none is within the tolerance. The first of equals wins.
+        /// </summary>
+        Symbol FindNearest(ulong[] shape, int inkCount, int width, int height)
+        {
+            List<Symbol> candidates;
+            if (!symbolsBySize.TryGetValue(width << 8 | height, out candidates))
+            {
+                return null;
+            }
+
+            Symbol nearest = null;
+            int nearestDistance = width * height / mismatchShare + 1;
+            foreach (var candidate in candidates)
+            {
+                if (Math.Abs(candidate.InkCount - inkCount) >= nearestDistance)
+                {
+                    continue;
+                }
+
+                int distance = 0;
+                for (int i = 0; i < shape.Length && distance < nearestDistance; ++i)
+                {
+                    distance += BitCount(shape[i] ^ candidate.Shape[i]);
+                }
+                if (distance < nearestDistance)
+                {
+                    nearest = candidate;
+                    nearestDistance = distance;
+                }
+            }
+            return nearest;
+        }
+
+        static int BitCount(ulong bits)
+        {
+            bits -= (bits >> 1) & 0x5555555555555555UL;
+            bits = (bits & 0x3333333333333333UL) + ((bits >> 2) & 0x3333333333333333UL);
+            bits = (bits + (bits >> 4)) & 0x0F0F0F0F0F0F0F0FUL;
+            return (int)((bits * 0x0101010101010101UL) >> 56);
+        }
+
+        /// <summary>
+        /// Placing pays when the symbol gets most of the component's pixels right,
+        /// the others cost residual runs.
+        /// </summary>
+        static bool IsWorthPlacing(Symbol symbol, Symbol found, int pixelCount)
+        {
+            int wrongCount = 0;
+            for (int pixel = 0; pixel < symbol.Levels.Length; ++pixel)
+            {
+                if (symbol.Levels[pixel] != found.Levels[pixel])
+                {
+                    ++wrongCount;
+                }
+            }
+            return wrongCount * 2 <= pixelCount;
+        }
+
+        /// <summary>
+        /// Runs [start, end) of residual pixels row by row, near runs joined.
+        /// </summary>
+        List<int[]> FindResidualRuns()
+        {
+            List<int[]> runs = new List<int[]>();
+            for (int pixel = 0; pixel < residual.Length; ++pixel)
+            {
+                if (!residual[pixel])
+                {
+                    continue;
+                }
+
+                if (runs.Count > 0 && pixel - runs[runs.Count - 1][1] <= maxResidualGap)
+                {
+                    runs[runs.Count - 1][1] = pixel + 1;
+                }
+                else
+                {
+                    runs.Add(new int[] { pixel, pixel + 1 });
+                }
+            }
+            return runs;
+        }
+
+        static void WriteLevels(BinaryWriter writer, byte[] source, int start, int count)
+        {
+            for (int i = 0; i < count; i += 2)
+            {
+                int low = i + 1 < count ? source[start + i + 1] : 0;
+                writer.Write((byte)(source[start + i] << 4 | low));
+            }
+        }
+
+        static int ZigZag(int value)
+        {
+            return (value << 1) ^ (value >> 31);
+        }
+
+        static void WriteVarint(BinaryWriter writer, int value)
+        {
+            uint rest = (uint)value;
+            while (rest >= 0x80)
+            {
+                writer.Write((byte)(rest | 0x80));
+                rest >>= 7;
+            }
+            writer.Write((byte)rest);
+        }
+
+        static int ReadVarint(byte[] content, ref int offset)
+        {
+            int value = 0;
+            for (int shift = 0; ; shift += 7)
+            {
+                byte part = content[offset++];
+                value |= (part & 0x7F) << shift;
+                if (part < 0x80)
+                {
+                    return value;
+                }
+            }
+        }
+
+        /// <summary>
+        /// Add the page counts of a codec that coded other pages of the book.
+        /// </summary>
+        public void MergeStatistics(SymbolCodec other)
+        {
+            encodedPageCount += other.encodedPageCount;
+            skippedPageCount += other.skippedPageCount;
+            placementCount += other.placementCount;
+            correctedPixelCount += other.correctedPixelCount;
+        }
+
+        public string GetStatistics()
+        {
+            return string.Format("{0} symbols in the dictionary, {1} pages as symbols with {2} placements and {3} corrected pixels, {4} pages kept as GIF",
+                dictionary.Count,
+                encodedPageCount,
+                placementCount,
+                correctedPixelCount,
+                skippedPageCount);
+        }
+    }
+}
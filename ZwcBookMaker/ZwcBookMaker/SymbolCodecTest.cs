@@ -0,0 +1,89 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Linq;
+using System.Text;
+using System.Diagnostics;
+using System.Drawing;
+using System.IO;
+using System.Windows.Forms;
+
+namespace ZwcBookMaker
+{
+    public class SymbolCodecTest
+    {
+        const int pageCount = 50;
+
+        public void Run()
+        {
+            string path = Path.Combine(Application.StartupPath, "人月神话.pdf");
+            string folder = Path.Combine(Path.GetTempPath(), "SymbolCodecTest");
+            Directory.CreateDirectory(folder);
+
+            List<byte[]> gifs = new List<byte[]>();
+            using (var foxitPdf = new FoxitPDFSDK())
+            using (var pdfSource = new MappedPDFSource(path))
+            using (var reader = new FoxitPDFReader(pdfSource))
+            {
+                PageOutPutter outPutter = new PageOutPutter(folder);
+                PageText pageText = new PageText();
+                int count = Math.Min(pageCount, reader.GetPageCount());
+                for (int pageIndex = 0; pageIndex < count; ++pageIndex)
+                {
+                    reader.ExtractText(pageIndex, pageText);
+                    using (Bitmap page = reader.RenderPage(pageIndex))
+                    {
+                        outPutter.AddPage(page, pageText.Lines);
+                    }
+                }
+                outPutter.Flush();
+
+                for (int pageIndex = 1; pageIndex <= outPutter.GetOutputPageCount(); ++pageIndex)
+                {
+                    gifs.Add(File.ReadAllBytes(Path.Combine(folder, string.Format("{0:D4}.gif", pageIndex))));
+                }
+            }
+            Directory.Delete(folder, true);
+
+            SymbolCodec codec = new SymbolCodec();
+            var encodeTime = Stopwatch.StartNew();
+            foreach (var gif in gifs)
+            {
+                codec.AddPage(gif);
+            }
+            byte[] dictionary = codec.BuildDictionary();
+            List<byte[]> pages = gifs.Select(gif => codec.EncodePage(gif) ?? gif).ToList();
+            encodeTime.Stop();
+
+            var gifTime = Stopwatch.StartNew();
+            foreach (var gif in gifs)
+            {
+                using (Bitmap page = new Bitmap(new MemoryStream(gif)))
+                {
+                }
+            }
+            gifTime.Stop();
+
+            var symbolTime = Stopwatch.StartNew();
+            foreach (var page in pages.Where(SymbolCodec.IsSymbolPage))
+            {
+                codec.DecodePage(page);
+            }
+            symbolTime.Stop();
+            int symbolPageCount = Math.Max(1, codec.EncodedPageCount);
+
+            MessageBox.Show(string.Format(
+                "{0} pages\n" +
+                "GIF: {1} KB, {2:F1} ms per page to decode\n" +
+                "Symbols: {3} KB with a {4} KB dictionary, {5:F1} ms per page to decode, {6:F1} s to encode\n" +
+                "{7}",
+                gifs.Count,
+                gifs.Sum(gif => gif.Length) / 1024,
+                gifTime.Elapsed.TotalMilliseconds / Math.Max(1, gifs.Count),
+                (pages.Sum(page => page.Length) + dictionary.Length) / 1024,
+                dictionary.Length / 1024,
+                symbolTime.Elapsed.TotalMilliseconds / symbolPageCount,
+                encodeTime.Elapsed.TotalSeconds,
+                codec.GetStatistics()));
+        }
+    }
+}
@@ -0,0 +1,89 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Linq;
+using System.Text;
+using System.Diagnostics;
+using System.IO;
+using System.Windows.Forms;
+
+namespace ZwcBookMaker
+{
+    public class TextExtractionTest
+    {
+        public void Run()
+        {
+            string path = Path.Combine(Application.StartupPath, "人月神话.pdf");
+
+            using (var foxitPdf = new FoxitPDFSDK())
+            {
+                IntPtr document = FoxitPDFSDK.FPDF_LoadDocument(path, null);
+                using (var reader = new FoxitPDFReader(document))
+                {
+                    int pageCount = reader.GetPageCount();
+
+                    // Every attribute of every character asked for on its own.
+                    long perCharGlyphs = 0;
+                    var perChar = Stopwatch.StartNew();
+                    for (int pageIndex = 0; pageIndex < pageCount; ++pageIndex)
+                    {
+                        perCharGlyphs += ExtractPerChar(document, pageIndex);
+                    }
+                    perChar.Stop();
+
+                    long bulkGlyphs = 0;
+                    PageText pageText = new PageText();
+                    var bulk = Stopwatch.StartNew();
+                    for (int pageIndex = 0; pageIndex < pageCount; ++pageIndex)
+                    {
+                        reader.ExtractText(pageIndex, pageText);
+                        bulkGlyphs += pageText.Count;
+                    }
+                    bulk.Stop();
+
+                    MessageBox.Show(string.Format(
+                        "{0} pages, {1} glyphs\n" +
+                        "Per character: {2:F0} glyphs/s\n" +
+                        "ExtractText: {3:F0} glyphs/s",
+                        pageCount,
+                        bulkGlyphs,
+                        perCharGlyphs / perChar.Elapsed.TotalSeconds,
+                        bulkGlyphs / bulk.Elapsed.TotalSeconds));
+                }
+            }
+        }
+
+        int ExtractPerChar(IntPtr document, int pageIndex)
+        {
+            IntPtr page = FoxitPDFSDK.FPDF_LoadPage(document, pageIndex);
+            IntPtr textPage = FoxitPDFSDK.FPDFText_LoadPage(page);
+            try
+            {
+                if (textPage == IntPtr.Zero)
+                {
+                    return 0;
+                }
+
+                int charCount = FoxitPDFSDK.FPDFText_CountChars(textPage);
+                for (int index = 0; index < charCount; ++index)
+                {
+                    double left, right, bottom, top;
+                    FoxitPDFSDK.FPDFText_GetUnicode(textPage, index);
+                    FoxitPDFSDK.FPDFText_IsGenerated(textPage, index);
+                    FoxitPDFSDK.FPDFText_GetFontSize(textPage, index);
+                    FoxitPDFSDK.FPDFText_GetFont(textPage, index);
+                    FoxitPDFSDK.FPDFText_GetCharBox(textPage, index, out left, out right, out bottom, out top);
+                }
+
+                return charCount;
+            }
+            finally
+            {
+                if (textPage != IntPtr.Zero)
+                {
+                    FoxitPDFSDK.FPDFText_ClosePage(textPage);
+                }
+                FoxitPDFSDK.FPDF_ClosePage(page);
+            }
+        }
+    }
+}
@@ -0,0 +1,172 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Linq;
+using System.Text;
+using System.Drawing;
+using System.IO;
+
+namespace ZwcBookMaker
+{
+    /// <summary>
+    /// Character boxes of every output page, in pixels of the saved (rotated)
+    /// page image, so the reader can tell which character is at a point.
+    ///
+    /// Section layout:
+    ///   int pageCount
+    ///   (pageCount + 1) x int offset of each page layer from the section start
+    ///   page layers, each as arrays:
+    ///     ushort count
+    ///     count x ushort unicode
+    ///     count x short left, delta from the previous character
+    ///     count x short top, delta from the previous character
+    ///     count x ushort width
+    ///     count x ushort height
+    /// </summary>
+    public class TextLayerBuilder : IPackageSection
+    {
+        public const string SectionTag = "TEXT";
+
+        class SourceChar
+        {
+            public char Unicode;
+            public Rectangle Box;
+        }
+
+        List<List<SourceChar>> sourcePages = new List<List<SourceChar>>();
+
+        public string Tag
+        {
+            get
+            {
+                return SectionTag;
+            }
+        }
+
+        public void AddSourcePage(FoxitPDFReader textReader, PageText pageText)
+        {
+            int sourcePageIndex = pageText.PageIndex;
+
+            List<SourceChar> chars = new List<SourceChar>();
+            for (int index = 0; index < pageText.Count; ++index)
+            {
+                char unicode = pageText.Unicode[index];
+                if (pageText.IsGenerated[index] || unicode == '\0' || char.IsWhiteSpace(unicode))
+                {
+                    continue;
+                }
+
+                chars.Add(new SourceChar()
+                {
+                    Unicode = unicode,
+                    Box = pageText.GetPixelBox(index)
+                });
+            }
+
+            while (sourcePages.Count <= sourcePageIndex)
+            {
+                sourcePages.Add(null);
+            }
+            sourcePages[sourcePageIndex] = chars;
+        }
+
+        public byte[] Build(FoxitPDFReader textReader, PageOutPutter outPutter)
+        {
+            int pageCount = outPutter.GetOutputPageCount();
+            List<List<SourceChar>> outputPages = new List<List<SourceChar>>();
+            for (int page = 0; page < pageCount; ++page)
+            {
+                outputPages.Add(new List<SourceChar>());
+            }
+
+            for (int sourcePageIndex = 0; sourcePageIndex < sourcePages.Count; ++sourcePageIndex)
+            {
+                if (sourcePages[sourcePageIndex] == null)
+                {
+                    continue;
+                }
+
+                foreach (var sourceChar in sourcePages[sourcePageIndex])
+                {
+                    Rectangle box = sourceChar.Box;
+
+                    // The page the middle of the character is on.
+                    Rectangle pageBox;
+                    int page = outPutter.GetOutputPageIndex(sourcePageIndex, box, out pageBox);
+                    if (page > pageCount)
+                    {
+                        continue;
+                    }
+
+                    outputPages[page - 1].Add(new SourceChar()
+                    {
+                        Unicode = sourceChar.Unicode,
+                        Box = PageOutPutter.RotateToSavedPage(pageBox)
+                    });
+                }
+            }
+
+            MemoryStream section = new MemoryStream();
+            using (BinaryWriter writer = new BinaryWriter(section))
+            {
+                writer.Write(pageCount);
+                int offsetTable = (int)section.Position;
+                for (int page = 0; page <= pageCount; ++page)
+                {
+                    writer.Write(0);
+                }
+
+                List<int> offsets = new List<int>();
+                foreach (var chars in outputPages)
+                {
+                    offsets.Add((int)section.Position);
+                    WritePageLayer(writer, chars);
+                }
+                offsets.Add((int)section.Position);
+
+                section.Seek(offsetTable, SeekOrigin.Begin);
+                foreach (int offset in offsets)
+                {
+                    writer.Write(offset);
+                }
+                writer.Flush();
+
+                return section.ToArray();
+            }
+        }
+
+        static void WritePageLayer(BinaryWriter writer, List<SourceChar> chars)
+        {
+            int count = Math.Min(chars.Count, ushort.MaxValue);
+            writer.Write((ushort)count);
+
+            for (int index = 0; index < count; ++index)
+            {
+                writer.Write((ushort)chars[index].Unicode);
+            }
+
+            int previous = 0;
+            for (int index = 0; index < count; ++index)
+            {
+                writer.Write((short)(chars[index].Box.Left - previous));
+                previous = chars[index].Box.Left;
+            }
+
+            previous = 0;
+            for (int index = 0; index < count; ++index)
+            {
+                writer.Write((short)(chars[index].Box.Top - previous));
+                previous = chars[index].Box.Top;
+            }
+
+            for (int index = 0; index < count; ++index)
+            {
+                writer.Write((ushort)chars[index].Box.Width);
+            }
+
+            for (int index = 0; index < count; ++index)
+            {
+                writer.Write((ushort)chars[index].Box.Height);
+            }
+        }
+    }
+}
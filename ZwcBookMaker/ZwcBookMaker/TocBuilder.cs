@@ -0,0 +1,66 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Linq;
+using System.Text;
+using System.IO;
+
+namespace ZwcBookMaker
+{
+    /// <summary>
+    /// Table of contents from the PDF outline, each entry pointing at the output
+    /// page showing its destination.
+    ///
+    /// Section layout:
+    ///   int count
+    ///   count x [ushort level][int output page][ushort title length][title, UTF-16LE]
+    /// </summary>
+    public class TocBuilder : IPackageSection
+    {
+        public const string SectionTag = "TOC ";
+
+        int entryCount = 0;
+
+        public string Tag
+        {
+            get
+            {
+                return SectionTag;
+            }
+        }
+
+        public void AddSourcePage(FoxitPDFReader textReader, PageText pageText)
+        {
+        }
+
+        public byte[] Build(FoxitPDFReader textReader, PageOutPutter outPutter)
+        {
+            // Bookmarks past the last page added, when the build was cancelled.
+            List<Bookmark> bookmarks = textReader.GetBookmarks()
+                .Where(bookmark => bookmark.PageIndex < outPutter.GetSourcePageCount())
+                .ToList();
+            entryCount = bookmarks.Count;
+
+            MemoryStream section = new MemoryStream();
+            using (BinaryWriter writer = new BinaryWriter(section))
+            {
+                writer.Write(bookmarks.Count);
+                foreach (var bookmark in bookmarks)
+                {
+                    string title = bookmark.Title.Length > ushort.MaxValue ? bookmark.Title.Substring(0, ushort.MaxValue) : bookmark.Title;
+
+                    writer.Write((ushort)bookmark.Level);
+                    writer.Write(outPutter.GetOutputPageIndex(bookmark.PageIndex, 0, bookmark.Y));
+                    writer.Write((ushort)title.Length);
+                    writer.Write(Encoding.Unicode.GetBytes(title));
+                }
+            }
+
+            return section.ToArray();
+        }
+
+        public string GetStatistics()
+        {
+            return string.Format("Table of contents {0} entries", entryCount);
+        }
+    }
+}
@@ -0,0 +1,217 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Linq;
+using System.Text;
+using System.Diagnostics;
+using System.Drawing;
+using System.Drawing.Imaging;
+using System.IO;
+using System.Windows.Forms;
+
+namespace ZwcBookMaker
+{
+    public class TranscoderTest
+    {
+        const int pageCount = 50;
+
+        public void Run()
+        {
+            string path = Path.Combine(Application.StartupPath, "人月神话.pdf");
+            string folder = Path.Combine(Path.GetTempPath(), "TranscoderTest");
+            Directory.CreateDirectory(folder);
+
+            List<byte[]> gifs = new List<byte[]>();
+            using (var foxitPdf = new FoxitPDFSDK())
+            using (var pdfSource = new MappedPDFSource(path))
+            using (var reader = new FoxitPDFReader(pdfSource))
+            {
+                PageOutPutter outPutter = new PageOutPutter(folder);
+                PageText pageText = new PageText();
+                int count = Math.Min(pageCount, reader.GetPageCount());
+                for (int pageIndex = 0; pageIndex < count; ++pageIndex)
+                {
+                    reader.ExtractText(pageIndex, pageText);
+                    using (Bitmap page = reader.RenderPage(pageIndex))
+                    {
+                        outPutter.AddPage(page, pageText.Lines);
+                    }
+                }
+                outPutter.Flush();
+
+                // Odd pages as the first PageOutPutter saved them, a 32 bit page
+                // through Save(Gif) with the GDI+ halftone palette, which must be
+                // carried over unchanged. Even pages are the 4 bit gray GIFs.
+                for (int pageIndex = 1; pageIndex <= outPutter.GetOutputPageCount(); ++pageIndex)
+                {
+                    byte[] gif = File.ReadAllBytes(Path.Combine(folder, string.Format("{0:D4}.gif", pageIndex)));
+                    gifs.Add(pageIndex % 2 == 1 ? SaveAsBaseline(gif) : gif);
+                }
+            }
+
+            // A package as BookPackager wrote it before: slots and GIF pages only.
+            string original = Path.Combine(folder, "v1.zwc_data");
+            using (BinaryWriter writer = new BinaryWriter(File.Create(original)))
+            {
+                int location = (gifs.Count + 2) * 4;
+                writer.Write(0);
+                foreach (var gif in gifs)
+                {
+                    writer.Write(location);
+                    location += gif.Length;
+                }
+                writer.Write(location);
+                foreach (var gif in gifs)
+                {
+                    writer.Write(gif);
+                }
+            }
+
+            string single = Path.Combine(folder, "single.zwc_data");
+            string parallel = Path.Combine(folder, "parallel.zwc_data");
+            string resumed = Path.Combine(folder, "resumed.zwc_data");
+            string stale = Path.Combine(folder, "stale.zwc_data");
+            File.Copy(original, single);
+            File.Copy(original, parallel);
+            File.Copy(original, resumed);
+            File.Copy(original, stale);
+
+            byte[] progressHeader;
+            using (FileStream package = File.OpenRead(original))
+            {
+                progressHeader = PackageTranscoder.GetProgressHeader(package.Length, PackageTranscoder.ReadSlots(package), false);
+            }
+
+            PackageTranscoder singleTranscoder = new PackageTranscoder(1, false);
+            singleTranscoder.Transcode(single);
+            PackageTranscoder parallelTranscoder = new PackageTranscoder(Environment.ProcessorCount, false);
+            parallelTranscoder.Transcode(parallel);
+
+            // A run stopped half way: the dictionary, half the pages and their records.
+            byte[] expected = File.ReadAllBytes(parallel);
+            int[] slots;
+            byte[] dictionary;
+            Dictionary<int, int> duplicates;
+            using (FileStream package = File.OpenRead(parallel))
+            {
+                slots = PackageTranscoder.ReadSlots(package);
+                var sections = PackageTranscoder.ReadSections(package, slots[0]);
+                dictionary = sections.First(section => section.Key == SymbolCodec.SectionTag).Value;
+                duplicates = PackageTranscoder.ReadDuplicates(sections);
+            }
+            int stoppedAfter = gifs.Count / 2;
+            File.WriteAllBytes(resumed + ".symb", dictionary);
+            using (FileStream part = File.Create(resumed + ".part"))
+            {
+                part.Write(new byte[slots[1]], 0, slots[1]);
+                part.Write(expected, slots[1], slots[stoppedAfter + 1] - slots[1]);
+            }
+            using (BinaryWriter progress = new BinaryWriter(File.Create(resumed + ".progress")))
+            {
+                progress.Write(progressHeader);
+                for (int pageIndex = 1; pageIndex <= stoppedAfter; ++pageIndex)
+                {
+                    progress.Write(slots[pageIndex + 1] - slots[pageIndex]);
+                    int storedPage;
+                    progress.Write(duplicates.TryGetValue(pageIndex, out storedPage) ? storedPage : 0);
+                }
+            }
+            new PackageTranscoder(Environment.ProcessorCount, false).Transcode(resumed);
+
+            // Files a run over another source left, which must not be used.
+            File.WriteAllBytes(stale + ".symb", new byte[4]);
+            File.WriteAllBytes(stale + ".part", new byte[slots[1] + 1000]);
+            using (BinaryWriter progress = new BinaryWriter(File.Create(stale + ".progress")))
+            {
+                progress.Write(PackageTranscoder.GetProgressHeader(1, slots, false));
+                progress.Write(1000);
+                progress.Write(0);
+            }
+            new PackageTranscoder(Environment.ProcessorCount, false).Transcode(stale);
+
+            bool isLossless = IsLossless(gifs, parallel);
+            bool isBaselineKept = IsBaselineKept(gifs, parallel);
+            bool isSame = File.ReadAllBytes(single).SequenceEqual(expected);
+            bool isResumed = File.ReadAllBytes(resumed).SequenceEqual(expected);
+            bool isStaleDropped = File.ReadAllBytes(stale).SequenceEqual(expected);
+            Directory.Delete(folder, true);
+
+            MessageBox.Show(string.Format(
+                "{0} pages, lossless: {1}, halftone pages kept: {2}, one worker gives the same package: {3}, resumed gives the same package: {4}, stale files dropped: {5}\n" +
+                "One worker: {6}\n" +
+                "{7} workers: {8}",
+                gifs.Count,
+                isLossless,
+                isBaselineKept,
+                isSame,
+                isResumed,
+                isStaleDropped,
+                singleTranscoder.GetStatistics(),
+                Environment.ProcessorCount,
+                parallelTranscoder.GetStatistics()));
+        }
+
+        static byte[] SaveAsBaseline(byte[] gif)
+        {
+            using (Bitmap gray = new Bitmap(new MemoryStream(gif)))
+            using (Bitmap page = new Bitmap(gray.Width, gray.Height))
+            {
+                using (Graphics graphics = Graphics.FromImage(page))
+                {
+                    graphics.DrawImageUnscaled(gray, 0, 0);
+                }
+
+                MemoryStream result = new MemoryStream();
+                page.Save(result, ImageFormat.Gif);
+                return result.ToArray();
+            }
+        }
+
+        static bool IsBaselineKept(List<byte[]> gifs, string packagePath)
+        {
+            using (FileStream package = File.OpenRead(packagePath))
+            {
+                int[] slots = PackageTranscoder.ReadSlots(package);
+                var sections = PackageTranscoder.ReadSections(package, slots[0]);
+                var duplicates = PackageTranscoder.ReadDuplicates(sections);
+
+                for (int pageIndex = 1; pageIndex <= gifs.Count; pageIndex += 2)
+                {
+                    if (!PackageTranscoder.ReadPage(package, slots, duplicates, pageIndex).SequenceEqual(gifs[pageIndex - 1]))
+                    {
+                        return false;
+                    }
+                }
+            }
+
+            return true;
+        }
+
+        static bool IsLossless(List<byte[]> gifs, string packagePath)
+        {
+            using (FileStream package = File.OpenRead(packagePath))
+            {
+                int[] slots = PackageTranscoder.ReadSlots(package);
+                var sections = PackageTranscoder.ReadSections(package, slots[0]);
+                var duplicates = PackageTranscoder.ReadDuplicates(sections);
+
+                SymbolCodec codec = new SymbolCodec();
+                codec.LoadDictionary(sections.First(section => section.Key == SymbolCodec.SectionTag).Value);
+                SymbolCodec reference = new SymbolCodec();
+                for (int pageIndex = 1; pageIndex <= gifs.Count; ++pageIndex)
+                {
+                    byte[] content = PackageTranscoder.ReadPage(package, slots, duplicates, pageIndex);
+                    byte[] gif = gifs[pageIndex - 1];
+                    bool isSame = SymbolCodec.IsSymbolPage(content)
+                        ? codec.DecodePage(content).SequenceEqual(reference.ReadPage(gif))
+                        : content.SequenceEqual(gif);
+                    if (!isSame)
+                    {
+                        return false;
+                    }
+                }
+            }
+
+            return true;
+        }
+    }
+}
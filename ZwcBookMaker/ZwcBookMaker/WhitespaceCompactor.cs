@@ -0,0 +1,121 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Linq;
+using System.Text;
+using System.Drawing;
+using System.Drawing.Imaging;
+
+namespace ZwcBookMaker
+{
+    /// <summary>
+    /// Squeezes blank rows out of source pages before they reach the canvas.
+    /// From the ink profile of the rows, the margins above and below the content
+    /// are dropped and every blank run longer than maxBlankRun becomes a gap of
+    /// gapHeight rows, so more content fits on each output page.
+    /// </summary>
+    public class WhitespaceCompactor
+    {
+        // Blank runs up to this height are line and paragraph spacing and stay.
+        const int maxBlankRun = 40;
+        const int gapHeight = 20;
+
+        // Same near white as PageOutPutter.FindWhiteRow.
+        const int whiteLevel = 220;
+
+        // Reused from page to page.
+        bool[] rowInk = new bool[0];
+
+        int pageCount = 0;
+        long inputRows = 0;
+        long outputRows = 0;
+
+        /// <summary>
+        /// Rows [top, bottom) of the bitmap to keep, top to bottom. Each ends with
+        /// up to gapHeight blank rows. A blank bitmap keeps one gap.
+        /// </summary>
+        public List<int[]> Compact(Bitmap bitmap)
+        {
+            int height = bitmap.Height;
+            FindInkRows(bitmap);
+
+            List<int[]> bands = new List<int[]>();
+            int y = 0;
+            while (y < height)
+            {
+                while (y < height && !rowInk[y])
+                {
+                    ++y;
+                }
+                if (y == height)
+                {
+                    break;
+                }
+
+                int top = y;
+                int lastInk = y;
+                for (; y < height; ++y)
+                {
+                    if (rowInk[y])
+                    {
+                        lastInk = y;
+                    }
+                    else if (y - lastInk > maxBlankRun)
+                    {
+                        break;
+                    }
+                }
+
+                bands.Add(new int[] { top, Math.Min(height, lastInk + 1 + gapHeight) });
+            }
+
+            if (bands.Count == 0)
+            {
+                bands.Add(new int[] { 0, Math.Min(height, gapHeight) });
+            }
+
+            ++pageCount;
+            inputRows += height;
+            outputRows += bands.Sum(band => band[1] - band[0]);
+            return bands;
+        }
+
+        unsafe void FindInkRows(Bitmap bitmap)
+        {
+            if (rowInk.Length < bitmap.Height)
+            {
+                rowInk = new bool[bitmap.Height];
+            }
+
+            BitmapData data = bitmap.LockBits(new Rectangle(0, 0, bitmap.Width, bitmap.Height), ImageLockMode.ReadOnly, PixelFormat.Format32bppRgb);
+            try
+            {
+                for (int y = 0; y < data.Height; ++y)
+                {
+                    byte* pixel = (byte*)data.Scan0 + (long)y * data.Stride;
+                    byte* end = pixel + data.Width * 4;
+                    bool ink = false;
+                    for (; pixel < end; pixel += 4)
+                    {
+                        if (pixel[0] < whiteLevel || pixel[1] < whiteLevel || pixel[2] < whiteLevel)
+                        {
+                            ink = true;
+                            break;
+                        }
+                    }
+                    rowInk[y] = ink;
+                }
+            }
+            finally
+            {
+                bitmap.UnlockBits(data);
+            }
+        }
+
+        public string GetStatistics()
+        {
+            return string.Format("Compacted {0} page parts to {1:P0} of their rows",
+                pageCount,
+                inputRows > 0 ? (double)outputRows / inputRows : 1);
+        }
+    }
+}
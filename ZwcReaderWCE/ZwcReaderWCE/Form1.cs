@@ -33,9 +33,27 @@ namespace ZwcReaderWCE
         int currentPage;
         SettingsProvider settingProvider = null;
 
+        SearchIndex searchIndex = null;
+        TextLayer textLayer = null;
+        TableOfContents tableOfContents = null;
+        PageMap pageMap = null;
+        LinkTable linkTable = null;
+        int pageBeforeLink = 0;
+        ListBox tocList = null;
+        TextBox searchBox = null;
+        int[] searchResults = new int[0];
+        int searchResultIndex = 0;
+
+        // Pages turned within this many ms of each other are drawn from their
+        // base layer until the flipping stops.
+        const int fastFlipInterval = 400;
+        int lastFlipTime = 0;
+        bool isFlippingFast = false;
+
         public Form1()
         {
             InitializeComponent();
+            this.MouseDown += new MouseEventHandler(Form1_MouseDown);
 
             //if (!IsPC())
             //{
@@ -64,6 +82,18 @@ namespace ZwcReaderWCE
                     case Keys.D1:
                         UserOpenBook();
                         break;
+                    case Keys.D2:
+                        ShowSearchBox();
+                        break;
+                    case Keys.D3:
+                        NextSearchResult();
+                        break;
+                    case Keys.D4:
+                        ShowTableOfContents();
+                        break;
+                    case Keys.D5:
+                        BackFromLink();
+                        break;
                     case Keys.D9:
                         Test();
                         break;
@@ -112,16 +142,291 @@ namespace ZwcReaderWCE
             label1.Text = string.Format(@"
 0: 退出
 1: 打开文件
+2: 搜索
+3: 下一个搜索结果
+4: 目录
+5: 返回链接前的页
 9: 测试
 回车: 显示或隐藏菜单
 
 {0} / {1}
-", currentPage, totalPages);
+{2}", currentPage, totalPages, GetSourcePageText());
+        }
+
+        string GetSourcePageText()
+        {
+            if (pageMap == null || !pageMap.IsAvailable)
+            {
+                return "";
+            }
+
+            List<PageMap.SourceSpan> spans = pageMap.GetSourceSpans(currentPage);
+            if (spans.Count == 0)
+            {
+                return "";
+            }
+
+            int first = spans[0].SourcePage + 1;
+            int last = spans[spans.Count - 1].SourcePage + 1;
+            return first == last ? string.Format("原书第 {0} 页", first) : string.Format("原书第 {0} - {1} 页", first, last);
         }
         
         private void Test()
         {
+            if (!isBookOpened)
+            {
+                return;
+            }
+
+            int start;
+            int elapsed;
+            string message = string.Format("{0} pages", totalPages);
+
+            // Older packages have no search index, the page timings below still apply.
+            if (searchIndex != null && searchIndex.IsAvailable)
+            {
+                // Time of a search query.
+                string[] queries = new string[] { "软件", "项目进度", "人月神话", "the", "没有银弹" };
+                const int rounds = 20;
+
+                start = Environment.TickCount;
+                int resultCount = 0;
+                for (int round = 0; round < rounds; ++round)
+                {
+                    foreach (string query in queries)
+                    {
+                        resultCount += searchIndex.Search(query).Length;
+                    }
+                }
+                elapsed = Environment.TickCount - start;
+
+                message += string.Format("\n{0:F1} ms per query, {1} results", (double)elapsed / (rounds * queries.Length), resultCount / rounds);
+            }
+
+            if (textLayer != null && textLayer.IsAvailable)
+            {
+                // Time of a hit test on the current page, over a grid of points.
+                Rectangle box;
+                textLayer.HitTest(currentPage, 0, 0, out box);
+
+                int hitCount = 0;
+                start = Environment.TickCount;
+                for (int y = 0; y < rect.Height; y += 8)
+                {
+                    for (int x = 0; x < rect.Width; x += 8)
+                    {
+                        if (textLayer.HitTest(currentPage, x, y, out box) != '\0')
+                        {
+                            ++hitCount;
+                        }
+                    }
+                }
+                elapsed = Environment.TickCount - start;
+
+                int testCount = (rect.Height / 8) * (rect.Width / 8);
+                message += string.Format("\n{0:F1} us per hit test, {1} hits", elapsed * 1000.0 / testCount, hitCount);
+            }
+
+            // Time to first paint of the next pages, base layer against full page.
+            int lastPage = Math.Min(currentPage + 10, totalPages);
+            int baseTime = 0;
+            int fullTime = 0;
+            for (int page = currentPage + 1; page <= lastPage; ++page)
+            {
+                start = Environment.TickCount;
+                using (Bitmap bitmap = cache.LoadPage(page, true))
+                {
+                    graphics.DrawImage(bitmap, rect, rect, GraphicsUnit.Pixel);
+                }
+                baseTime += Environment.TickCount - start;
+
+                start = Environment.TickCount;
+                using (Bitmap bitmap = cache.LoadPage(page, false))
+                {
+                    graphics.DrawImage(bitmap, rect, rect, GraphicsUnit.Pixel);
+                }
+                fullTime += Environment.TickCount - start;
+            }
+            if (lastPage > currentPage)
+            {
+                int pageCount = lastPage - currentPage;
+                message += string.Format("\n{0:F0} ms per page flipping fast, {1:F0} ms per full page",
+                    (double)baseTime / pageCount,
+                    (double)fullTime / pageCount);
+
+                // Decode time of the same pages through GDI, GIF pages only differ.
+                cache.UseGifDecoder = false;
+                start = Environment.TickCount;
+                for (int page = currentPage + 1; page <= lastPage; ++page)
+                {
+                    using (Bitmap bitmap = cache.LoadPage(page, false))
+                    {
+                    }
+                }
+                int gdiTime = Environment.TickCount - start;
+
+                cache.UseGifDecoder = true;
+                start = Environment.TickCount;
+                for (int page = currentPage + 1; page <= lastPage; ++page)
+                {
+                    using (Bitmap bitmap = cache.LoadPage(page, false))
+                    {
+                    }
+                }
+                int decoderTime = Environment.TickCount - start;
+
+                message += string.Format("\n{0:F0} ms per page with GDI, {1:F0} ms with GifDecoder",
+                    (double)gdiTime / pageCount,
+                    (double)decoderTime / pageCount);
+            }
+            DrawPage();
+
+            MessageBox.Show(message);
+        }
+
+        private void ShowSearchBox()
+        {
+            if (searchIndex == null || !searchIndex.IsAvailable)
+            {
+                return;
+            }
+
+            if (searchBox == null)
+            {
+                searchBox = new TextBox();
+                searchBox.Font = new Font("Tahoma", 16F, FontStyle.Regular);
+                searchBox.Location = new Point(84, 380);
+                searchBox.Size = new Size(414, 40);
+                searchBox.KeyDown += new KeyEventHandler(searchBox_KeyDown);
+                this.Controls.Add(searchBox);
+            }
+
+            searchBox.Text = "";
+            searchBox.Visible = true;
+            searchBox.Focus();
+        }
+
+        private void searchBox_KeyDown(object sender, KeyEventArgs e)
+        {
+            if (e.KeyCode != Keys.Enter)
+            {
+                return;
+            }
+
+            string query = searchBox.Text;
+            searchBox.Visible = false;
+            this.Focus();
+
+            searchResults = searchIndex.Search(query);
+            searchResultIndex = -1;
+
+            label1.Text = string.Format("\n\n“{0}” 共 {1} 页", query, searchResults.Length);
+            label1.Visible = true;
+
+            NextSearchResult();
+        }
+
+        private void NextSearchResult()
+        {
+            if (searchResults.Length == 0)
+            {
+                return;
+            }
+
+            searchResultIndex = (searchResultIndex + 1) % searchResults.Length;
+            GoToPage(searchResults[searchResultIndex]);
+        }
+
+        private void ShowTableOfContents()
+        {
+            if (tableOfContents == null || tableOfContents.Entries.Count == 0)
+            {
+                return;
+            }
+
+            if (tocList == null)
+            {
+                tocList = new ListBox();
+                tocList.Font = new Font("Tahoma", 14F, FontStyle.Regular);
+                tocList.Location = new Point(0, 0);
+                tocList.Size = new Size(rect.Width, rect.Height);
+                tocList.KeyDown += new KeyEventHandler(tocList_KeyDown);
+                this.Controls.Add(tocList);
+            }
+
+            tocList.Items.Clear();
+            foreach (TableOfContents.Entry entry in tableOfContents.Entries)
+            {
+                tocList.Items.Add(new string('　', entry.Level) + entry.Title);
+            }
+
+            tocList.SelectedIndex = Math.Max(tableOfContents.FindEntry(currentPage), 0);
+            tocList.Visible = true;
+            tocList.Focus();
+        }
+
+        private void tocList_KeyDown(object sender, KeyEventArgs e)
+        {
+            if (e.KeyCode != Keys.Enter && e.KeyCode != Keys.D4)
+            {
+                return;
+            }
+
+            tocList.Visible = false;
+            this.Focus();
 
+            if (e.KeyCode == Keys.Enter && tocList.SelectedIndex >= 0)
+            {
+                GoToPage(tableOfContents.Entries[tocList.SelectedIndex].Page);
+            }
+            else
+            {
+                DrawPage();
+            }
+        }
+
+        private void Form1_MouseDown(object sender, MouseEventArgs e)
+        {
+            if (linkTable == null || !linkTable.IsAvailable)
+            {
+                return;
+            }
+
+            int targetPage;
+            string url;
+            if (!linkTable.FindLink(currentPage, e.X, e.Y, out targetPage, out url))
+            {
+                return;
+            }
+
+            if (targetPage > 0)
+            {
+                pageBeforeLink = currentPage;
+                GoToPage(targetPage);
+            }
+            else if (url != null)
+            {
+                label1.Text = "\n\n" + url;
+                label1.Visible = true;
+            }
+        }
+
+        private void BackFromLink()
+        {
+            if (pageBeforeLink > 0)
+            {
+                GoToPage(pageBeforeLink);
+                pageBeforeLink = 0;
+            }
+        }
+
+        void GoToPage(int page)
+        {
+            if (isBookOpened)
+            {
+                currentPage = page;
+                AddPageIndex(0);
+            }
         }
 
         private void UserOpenBook()
@@ -162,7 +467,35 @@ namespace ZwcReaderWCE
             totalPages = int.Parse(settingProvider["TotalPages"]);
             currentPage = int.Parse(settingProvider["CurrentPage"]);
             string pageFolder = Path.Combine(Path.GetDirectoryName(filePath), Path.GetFileNameWithoutExtension(filePath));
-            cache = new PageCache(pageFolder, totalPages);
+            PackageSections sections = new PackageSections(pageFolder + ".zwc_data");
+            if (cache != null)
+            {
+                cache.Dispose();
+            }
+            cache = new PageCache(pageFolder, totalPages, sections);
+            cache.PageRefined += new EventHandler(cache_PageRefined);
+
+            if (searchIndex != null)
+            {
+                searchIndex.Dispose();
+            }
+            searchIndex = new SearchIndex(sections);
+
+            if (textLayer != null)
+            {
+                textLayer.Dispose();
+            }
+            textLayer = new TextLayer(sections);
+            tableOfContents = new TableOfContents(sections);
+            pageMap = new PageMap(sections);
+
+            if (linkTable != null)
+            {
+                linkTable.Dispose();
+            }
+            linkTable = new LinkTable(sections);
+            pageBeforeLink = 0;
+            searchResults = new int[0];
             isBookOpened = true;
             DrawPage();
         }
@@ -191,6 +524,10 @@ namespace ZwcReaderWCE
                     currentPage = 1;
                 }
 
+                int now = Environment.TickCount;
+                isFlippingFast = now - lastFlipTime < fastFlipInterval;
+                lastFlipTime = now;
+
                 DrawPage();
 
                 settingProvider["CurrentPage"] = currentPage.ToString();
@@ -202,11 +539,23 @@ namespace ZwcReaderWCE
         {
             if (isBookOpened)
             {
-                Bitmap bitmap = cache.GetPage(currentPage);
+                Bitmap bitmap = cache.GetPage(currentPage, isFlippingFast);
                 graphics.DrawImage(bitmap, rect, rect, GraphicsUnit.Pixel);
             }
         }
 
+        void cache_PageRefined(object sender, EventArgs e)
+        {
+            // Raised on the caching thread.
+            this.Invoke(new EventHandler(RedrawRefinedPage));
+        }
+
+        void RedrawRefinedPage(object sender, EventArgs e)
+        {
+            isFlippingFast = false;
+            DrawPage();
+        }
+
         bool IsPC()
         {
             return File.Exists("pc");
@@ -0,0 +1,300 @@
+﻿using System;
+
+using System.Collections.Generic;
+using System.Text;
+using System.Drawing;
+using System.Drawing.Imaging;
+using System.Runtime.InteropServices;
+
+namespace ZwcReaderWCE
+{
+    /// <summary>
+    /// Decoder for the GIF pages of older packages: one frame covering the
+    /// whole image, palette indices mapped straight to the 16 bit colors of
+    /// the screen bitmap. Anything else is left to GDI, Decode returns null.
+    /// </summary>
+    public class GifDecoder
+    {
+        const int maxCodeCount = 4096;
+
+        // Each code is a run of pixels already written, at codeOffsets[code] and
+        // codeLengths[code] long. A new code is the previous run plus the first
+        // pixel of the current one, which follows it, so no string is ever built.
+        int[] codeOffsets = new int[maxCodeCount];
+        int[] codeLengths = new int[maxCodeCount];
+
+        // Reused from page to page.
+        byte[] pixels = new byte[0];
+        byte[] codeData = new byte[0];
+        int codeDataLength = 0;
+        short[] row = new short[0];
+        short[] colors = new short[256];
+
+        public static bool IsGif(byte[] content)
+        {
+            return content.Length >= 13 && content[0] == 'G' && content[1] == 'I' && content[2] == 'F';
+        }
+
+        public Bitmap Decode(byte[] content)
+        {
+            if (!IsGif(content))
+            {
+                return null;
+            }
+
+            int width = content[6] | (content[7] << 8);
+            int height = content[8] | (content[9] << 8);
+            int offset = 13;
+            if ((content[10] & 0x80) != 0)
+            {
+                offset = ReadPalette(content, offset, content[10] & 7);
+            }
+
+            // Skip extensions up to the image.
+            while (offset < content.Length && content[offset] == 0x21)
+            {
+                offset = SkipBlocks(content, offset + 2);
+            }
+
+            if (offset + 10 > content.Length || content[offset] != 0x2C)
+            {
+                return null;
+            }
+
+            int left = content[offset + 1] | (content[offset + 2] << 8);
+            int top = content[offset + 3] | (content[offset + 4] << 8);
+            int frameWidth = content[offset + 5] | (content[offset + 6] << 8);
+            int frameHeight = content[offset + 7] | (content[offset + 8] << 8);
+            int flags = content[offset + 9];
+            offset += 10;
+            if (left != 0 || top != 0 || frameWidth != width || frameHeight != height || width == 0 || height == 0)
+            {
+                return null;
+            }
+
+            if ((flags & 0x80) != 0)
+            {
+                offset = ReadPalette(content, offset, flags & 7);
+            }
+
+            if (offset >= content.Length)
+            {
+                return null;
+            }
+
+            int minCodeSize = content[offset];
+            if (minCodeSize < 2 || minCodeSize > 8 || !JoinBlocks(content, offset + 1))
+            {
+                return null;
+            }
+
+            if (pixels.Length < width * height)
+            {
+                pixels = new byte[width * height];
+            }
+            Decompress(minCodeSize, width * height);
+
+            return ToBitmap(width, height, (flags & 0x40) != 0);
+        }
+
+        int ReadPalette(byte[] content, int offset, int sizeBits)
+        {
+            int count = 2 << sizeBits;
+            for (int index = 0; index < count && offset + 2 < content.Length; ++index, offset += 3)
+            {
+                int red = content[offset];
+                int green = content[offset + 1];
+                int blue = content[offset + 2];
+                colors[index] = (short)(((red >> 3) << 11) | ((green >> 2) << 5) | (blue >> 3));
+            }
+            return offset;
+        }
+
+        static int SkipBlocks(byte[] content, int offset)
+        {
+            while (offset < content.Length && content[offset] != 0)
+            {
+                offset += content[offset] + 1;
+            }
+            return offset + 1;
+        }
+
+        /// <summary>
+        /// Copy the data sub-blocks of the image into one run of code bytes.
+        /// </summary>
+        bool JoinBlocks(byte[] content, int offset)
+        {
+            int length = 0;
+            for (int position = offset; position < content.Length && content[position] != 0; position += content[position] + 1)
+            {
+                length += content[position];
+            }
+
+            if (codeData.Length < length)
+            {
+                codeData = new byte[length];
+            }
+
+            int target = 0;
+            while (offset < content.Length && content[offset] != 0)
+            {
+                int blockLength = content[offset];
+                if (offset + 1 + blockLength > content.Length)
+                {
+                    return false;
+                }
+
+                Array.Copy(content, offset + 1, codeData, target, blockLength);
+                target += blockLength;
+                offset += blockLength + 1;
+            }
+            codeDataLength = target;
+
+            return true;
+        }
+
+        void Decompress(int minCodeSize, int pixelCount)
+        {
+            int clearCode = 1 << minCodeSize;
+            int endCode = clearCode + 1;
+            int codeSize = minCodeSize + 1;
+            int codeMask = (1 << codeSize) - 1;
+            int nextCode = endCode + 1;
+
+            int bitBuffer = 0;
+            int bitCount = 0;
+            int dataOffset = 0;
+
+            int position = 0;
+            int previousOffset = -1;
+            int previousLength = 0;
+
+            while (position < pixelCount)
+            {
+                while (bitCount < codeSize)
+                {
+                    if (dataOffset >= codeDataLength)
+                    {
+                        position = pixelCount;
+                        break;
+                    }
+                    bitBuffer |= codeData[dataOffset++] << bitCount;
+                    bitCount += 8;
+                }
+                if (bitCount < codeSize)
+                {
+                    break;
+                }
+
+                int code = bitBuffer & codeMask;
+                bitBuffer >>= codeSize;
+                bitCount -= codeSize;
+
+                if (code == clearCode)
+                {
+                    codeSize = minCodeSize + 1;
+                    codeMask = (1 << codeSize) - 1;
+                    nextCode = endCode + 1;
+                    previousOffset = -1;
+                    continue;
+                }
+
+                if (code == endCode)
+                {
+                    break;
+                }
+
+                int start = position;
+                if (code < clearCode)
+                {
+                    pixels[position++] = (byte)code;
+                }
+                else if (code < nextCode)
+                {
+                    int length = Math.Min(codeLengths[code], pixelCount - position);
+                    Array.Copy(pixels, codeOffsets[code], pixels, position, length);
+                    position += length;
+                }
+                else if (code == nextCode && previousOffset >= 0)
+                {
+                    // The code being defined: previous run plus its own first pixel.
+                    int length = Math.Min(previousLength, pixelCount - position);
+                    Array.Copy(pixels, previousOffset, pixels, position, length);
+                    position += length;
+                    if (position < pixelCount)
+                    {
+                        pixels[position++] = pixels[previousOffset];
+                    }
+                }
+                else
+                {
+                    // Broken stream, keep what there is.
+                    break;
+                }
+
+                if (previousOffset >= 0 && nextCode < maxCodeCount)
+                {
+                    codeOffsets[nextCode] = previousOffset;
+                    codeLengths[nextCode] = previousLength + 1;
+                    ++nextCode;
+                    if (nextCode > codeMask && codeSize < 12)
+                    {
+                        ++codeSize;
+                        codeMask = (1 << codeSize) - 1;
+                    }
+                }
+
+                previousOffset = start;
+                previousLength = position - start;
+            }
+
+            // Pixels the stream did not reach are left at index 0.
+            if (position < pixelCount)
+            {
+                Array.Clear(pixels, position, pixelCount - position);
+            }
+        }
+
+        Bitmap ToBitmap(int width, int height, bool isInterlaced)
+        {
+            if (row.Length < width)
+            {
+                row = new short[width];
+            }
+
+            Bitmap page = new Bitmap(width, height, PixelFormat.Format16bppRgb565);
+            BitmapData data = page.LockBits(new Rectangle(0, 0, width, height), ImageLockMode.WriteOnly, PixelFormat.Format16bppRgb565);
+            try
+            {
+                int pass = 0;
+                int y = 0;
+                int step = isInterlaced ? 8 : 1;
+                for (int sourceY = 0; sourceY < height; ++sourceY)
+                {
+                    int source = sourceY * width;
+                    for (int x = 0; x < width; ++x)
+                    {
+                        row[x] = colors[pixels[source + x]];
+                    }
+                    Marshal.Copy(row, 0, new IntPtr(data.Scan0.ToInt32() + y * data.Stride), width);
+
+                    // Interlaced rows come every 8th from 0, every 8th from 4,
+                    // every 4th from 2 and every 2nd from 1.
+                    y += step;
+                    while (isInterlaced && y >= height && pass < 3)
+                    {
+                        ++pass;
+                        y = pass == 1 ? 4 : (pass == 2 ? 2 : 1);
+                        step = pass == 1 ? 8 : (pass == 2 ? 4 : 2);
+                    }
+                }
+            }
+            finally
+            {
+                page.UnlockBits(data);
+            }
+
+            return page;
+        }
+    }
+}
\ No newline at end of file
@@ -0,0 +1,87 @@
+﻿using System;
+
+using System.Collections.Generic;
+using System.Text;
+using System.Drawing;
+
+namespace ZwcReaderWCE
+{
+    /// <summary>
+    /// Page written by the reflow build mode: runs of text with their position
+    /// and pixel size, drawn with the device font.
+    /// </summary>
+    public static class GlyphRunPage
+    {
+        const int pageWidth = 600;
+        const int pageHeight = 800;
+        const string fontName = "SimSun";
+        const byte headingFlag = 1;
+
+        static readonly byte[] pageMagic = Encoding.ASCII.GetBytes("ZRF1");
+
+        public static bool IsGlyphRunPage(byte[] content)
+        {
+            if (content.Length < pageMagic.Length)
+            {
+                return false;
+            }
+
+            for (int i = 0; i < pageMagic.Length; ++i)
+            {
+                if (content[i] != pageMagic[i])
+                {
+                    return false;
+                }
+            }
+
+            return true;
+        }
+
+        public static Bitmap Render(byte[] content)
+        {
+            Bitmap page = new Bitmap(pageWidth, pageHeight);
+            using (Graphics graphics = Graphics.FromImage(page))
+            using (SolidBrush brush = new SolidBrush(Color.Black))
+            {
+                graphics.Clear(Color.White);
+
+                // Fonts are created in points, runs are sized in pixels.
+                Dictionary<int, Font> fonts = new Dictionary<int, Font>();
+                float pointsPerPixel = 72f / graphics.DpiY;
+
+                int offset = pageMagic.Length;
+                int runCount = BitConverter.ToUInt16(content, offset);
+                offset += 2;
+
+                for (int runIndex = 0; runIndex < runCount; ++runIndex)
+                {
+                    int x = BitConverter.ToUInt16(content, offset);
+                    int y = BitConverter.ToUInt16(content, offset + 2);
+                    int size = content[offset + 4];
+                    byte flags = content[offset + 5];
+                    int length = BitConverter.ToUInt16(content, offset + 6);
+                    offset += 8;
+
+                    string text = Encoding.Unicode.GetString(content, offset, length * 2);
+                    offset += length * 2;
+
+                    int fontKey = size * 2 + (flags & headingFlag);
+                    if (!fonts.ContainsKey(fontKey))
+                    {
+                        FontStyle style = (flags & headingFlag) != 0 ? FontStyle.Bold : FontStyle.Regular;
+                        fonts[fontKey] = new Font(fontName, size * pointsPerPixel, style);
+                    }
+
+                    graphics.DrawString(text, fonts[fontKey], brush, x, y);
+                }
+
+                foreach (Font font in fonts.Values)
+                {
+                    font.Dispose();
+                }
+            }
+
+            return page;
+        }
+    }
+}
\ No newline at end of file
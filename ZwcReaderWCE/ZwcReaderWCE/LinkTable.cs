@@ -0,0 +1,123 @@
+﻿using System;
+
+using System.Collections.Generic;
+using System.Text;
+using System.IO;
+
+namespace ZwcReaderWCE
+{
+    /// <summary>
+    /// Links of each page from the LINK section written by BookMaker. A lookup
+    /// reads the entries of one page, sorted by top, and stops at the first
+    /// entry below the point.
+    /// </summary>
+    public class LinkTable : IDisposable
+    {
+        public const string SectionTag = "LINK";
+        const int entrySize = 16;
+
+        FileStream package;
+        int sectionOffset;
+        int pageCount;
+        int urlTableOffset;
+
+        public LinkTable(PackageSections sections)
+        {
+            int length;
+            if (!sections.Find(SectionTag, out sectionOffset, out length))
+            {
+                return;
+            }
+
+            package = sections.Open();
+            package.Seek(sectionOffset, SeekOrigin.Begin);
+            pageCount = PackageSections.ReadInt(package);
+
+            package.Seek(sectionOffset + 4 + pageCount * 4, SeekOrigin.Begin);
+            urlTableOffset = PackageSections.ReadInt(package);
+        }
+
+        public void Dispose()
+        {
+            if (package != null)
+            {
+                package.Close();
+                package = null;
+            }
+        }
+
+        public bool IsAvailable
+        {
+            get
+            {
+                return package != null;
+            }
+        }
+
+        /// <summary>
+        /// The link at a point of a page. targetPage is the book page to jump to,
+        /// 0 for a web link, whose address is in url.
+        /// </summary>
+        public bool FindLink(int page, int x, int y, out int targetPage, out string url)
+        {
+            targetPage = 0;
+            url = null;
+            if (package == null || page < 1 || page > pageCount)
+            {
+                return false;
+            }
+
+            package.Seek(sectionOffset + 4 + (page - 1) * 4, SeekOrigin.Begin);
+            int offset = PackageSections.ReadInt(package);
+
+            byte[] countBytes = new byte[2];
+            package.Seek(sectionOffset + offset, SeekOrigin.Begin);
+            package.Read(countBytes, 0, countBytes.Length);
+            int count = BitConverter.ToUInt16(countBytes, 0);
+
+            byte[] entries = new byte[count * entrySize];
+            package.Read(entries, 0, entries.Length);
+
+            for (int index = 0; index < count; ++index)
+            {
+                int position = index * entrySize;
+                int left = BitConverter.ToInt16(entries, position);
+                int top = BitConverter.ToInt16(entries, position + 2);
+                int width = BitConverter.ToUInt16(entries, position + 4);
+                int height = BitConverter.ToUInt16(entries, position + 6);
+                if (top > y)
+                {
+                    break;
+                }
+
+                if (x >= left && x < left + width && y < top + height)
+                {
+                    targetPage = BitConverter.ToInt32(entries, position + 8);
+                    int urlIndex = BitConverter.ToInt32(entries, position + 12);
+                    if (urlIndex >= 0)
+                    {
+                        url = ReadUrl(urlIndex);
+                    }
+                    return true;
+                }
+            }
+
+            return false;
+        }
+
+        string ReadUrl(int urlIndex)
+        {
+            package.Seek(sectionOffset + urlTableOffset, SeekOrigin.Begin);
+            int urlCount = PackageSections.ReadInt(package);
+
+            package.Seek(sectionOffset + urlTableOffset + 4 + urlIndex * 4, SeekOrigin.Begin);
+            int start = PackageSections.ReadInt(package);
+            int end = PackageSections.ReadInt(package);
+
+            byte[] chars = new byte[(end - start) * 2];
+            package.Seek(sectionOffset + urlTableOffset + 4 + (urlCount + 1) * 4 + start * 2, SeekOrigin.Begin);
+            package.Read(chars, 0, chars.Length);
+            return Encoding.Unicode.GetString(chars, 0, chars.Length);
+        }
+    }
+}
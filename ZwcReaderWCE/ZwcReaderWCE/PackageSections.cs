@@ -0,0 +1,98 @@
+﻿using System;
+
+using System.Collections.Generic;
+using System.Text;
+using System.IO;
+
+namespace ZwcReaderWCE
+{
+    /// <summary>
+    /// Section directory of a book package. Slot 0 of the page table points to
+    /// it, older packages have 0 there and no sections.
+    /// </summary>
+    public class PackageSections
+    {
+        class Section
+        {
+            public int Offset;
+            public int Length;
+        }
+
+        string packagePath;
+        Dictionary<string, Section> sections = new Dictionary<string, Section>();
+
+        public PackageSections(string packagePath)
+        {
+            this.packagePath = packagePath;
+            if (!File.Exists(packagePath))
+            {
+                return;
+            }
+
+            using (FileStream package = Open(packagePath))
+            {
+                int directoryOffset = ReadInt(package);
+                if (directoryOffset <= 0 || directoryOffset >= package.Length)
+                {
+                    return;
+                }
+
+                package.Seek(directoryOffset, SeekOrigin.Begin);
+                int count = ReadInt(package);
+                for (int i = 0; i < count; ++i)
+                {
+                    byte[] tag = new byte[4];
+                    package.Read(tag, 0, tag.Length);
+
+                    Section section = new Section();
+                    section.Offset = ReadInt(package);
+                    section.Length = ReadInt(package);
+                    sections[Encoding.ASCII.GetString(tag, 0, tag.Length)] = section;
+                }
+            }
+        }
+
+        public string PackagePath
+        {
+            get
+            {
+                return packagePath;
+            }
+        }
+
+        /// <summary>
+        /// The page cache and every section reader keep their own stream on the
+        /// package, so it is always opened shared for reading.
+        /// </summary>
+        public static FileStream Open(string packagePath)
+        {
+            return File.Open(packagePath, FileMode.Open, FileAccess.Read, FileShare.Read);
+        }
+
+        public FileStream Open()
+        {
+            return Open(packagePath);
+        }
+
+        public bool Find(string tag, out int offset, out int length)
+        {
+            offset = 0;
+            length = 0;
+            if (!sections.ContainsKey(tag))
+            {
+                return false;
+            }
+
+            offset = sections[tag].Offset;
+            length = sections[tag].Length;
+            return true;
+        }
+
+        public static int ReadInt(Stream stream)
+        {
+            byte[] bytes = new byte[4];
+            stream.Read(bytes, 0, bytes.Length);
+            return BitConverter.ToInt32(bytes, 0);
+        }
+    }
+}
@@ -8,7 +8,7 @@ using System.Threading;
 
 namespace ZwcReaderWCE
 {
-    public class PageCache
+    public class PageCache : IDisposable
     {
         Timer timer;
 
@@ -21,24 +21,112 @@ namespace ZwcReaderWCE
 
         FileStream bookPackage = null;
 
-        public PageCache(string pageFolder, int totalPages)
+        // Pages stored once in the package for several book pages, from the PDUP section.
+        public const string DuplicateSectionTag = "PDUP";
+        Dictionary<int, int> storedPages = new Dictionary<int, int>();
+
+        SymbolPage symbolPage;
+        GifDecoder gifDecoder = new GifDecoder();
+
+        // Base layer of a progressive page shown while flipping fast, never cached.
+        Bitmap basePage = null;
+        bool isBaseShown = false;
+
+        bool isDisposed = false;
+
+        /// <summary>
+        /// Raised from the caching thread when the full page replaces the base
+        /// layer of the current page.
+        /// </summary>
+        public event EventHandler PageRefined;
+
+        public PageCache(string pageFolder, int totalPages, PackageSections sections)
         {
             string packagePath = pageFolder + ".zwc_data";
             if (File.Exists(packagePath))
             {
-                bookPackage = File.Open(packagePath, FileMode.Open, FileAccess.Read);
+                bookPackage = PackageSections.Open(packagePath);
+                ReadDuplicates(sections);
             }
 
             this.totalPages = totalPages;
             this.pageFolder = pageFolder;
+            this.symbolPage = new SymbolPage(sections);
+            this.UseGifDecoder = true;
+        }
+
+        /// <summary>
+        /// GIF pages go through GifDecoder, otherwise through GDI.
+        /// </summary>
+        public bool UseGifDecoder { get; set; }
+
+        void ReadDuplicates(PackageSections sections)
+        {
+            int offset, length;
+            if (!sections.Find(DuplicateSectionTag, out offset, out length))
+            {
+                return;
+            }
+
+            bookPackage.Seek(offset, SeekOrigin.Begin);
+            int count = ReadInt(bookPackage);
+            for (int i = 0; i < count; ++i)
+            {
+                int page = ReadInt(bookPackage);
+                storedPages[page] = ReadInt(bookPackage);
+            }
+        }
+
+        /// <summary>
+        /// The page whose bytes are shown on a book page.
+        /// </summary>
+        int GetStoredPage(int index)
+        {
+            int storedPage;
+            return storedPages.TryGetValue(index, out storedPage) ? storedPage : index;
         }
 
         public Bitmap GetPage(int index)
+        {
+            return GetPage(index, false);
+        }
+
+        /// <summary>
+        /// With baseOnly a page not in the cache is drawn from its base layer
+        /// when it has one, the full page follows with PageRefined.
+        /// </summary>
+        public Bitmap GetPage(int index, bool baseOnly)
         {
             lock (cacheLock)
             {
+                // The base layer drawn before is on the screen already.
+                if (basePage != null)
+                {
+                    basePage.Dispose();
+                    basePage = null;
+                }
+
                 // Get page from cache or file
-                Bitmap page = GetPageFromCacheOrFile(index);
+                Bitmap page = null;
+                isBaseShown = false;
+                if (baseOnly && !cachePages.ContainsKey(index))
+                {
+                    bool isBase;
+                    page = LoadPageFromFile(index, true, out isBase);
+                    if (isBase)
+                    {
+                        basePage = page;
+                        isBaseShown = true;
+                    }
+                    else if (page != null)
+                    {
+                        cachePages[index] = page;
+                    }
+                }
+                else
+                {
+                    page = GetPageFromCacheOrFile(index);
+                }
 
                 // Refresh timer for caching pages in background thread.
                 if (currentPageIndex != index)
@@ -51,6 +139,46 @@ namespace ZwcReaderWCE
             }
         }
 
+        /// <summary>
+        /// Stop the caching timer and release the package and the cached pages.
+        /// </summary>
+        public void Dispose()
+        {
+            lock (cacheLock)
+            {
+                isDisposed = true;
+                if (timer != null)
+                {
+                    timer.Dispose();
+                    timer = null;
+                }
+
+                if (bookPackage != null)
+                {
+                    bookPackage.Close();
+                    bookPackage = null;
+                }
+
+                // Pages sharing stored bytes share the bitmap, each is disposed once.
+                List<Bitmap> pages = new List<Bitmap>();
+                foreach (Bitmap page in cachePages.Values)
+                {
+                    if (!pages.Contains(page))
+                    {
+                        pages.Add(page);
+                        page.Dispose();
+                    }
+                }
+                cachePages.Clear();
+
+                if (basePage != null)
+                {
+                    basePage.Dispose();
+                    basePage = null;
+                }
+            }
+        }
+
         void RefreshTimer()
         {
             if (this.timer != null)
@@ -63,12 +191,26 @@ namespace ZwcReaderWCE
 
         void CachingPages(object state)
         {
+            bool isRefined;
             lock (cacheLock)
             {
+                if (isDisposed)
+                {
+                    return;
+                }
+
+                isRefined = isBaseShown;
+                isBaseShown = false;
+                GetPageFromCacheOrFile(currentPageIndex);
                 GetPageFromCacheOrFile(currentPageIndex - 1);
                 GetPageFromCacheOrFile(currentPageIndex + 1);
                 ReleasePages();
             }
+
+            if (isRefined && PageRefined != null)
+            {
+                PageRefined(this, EventArgs.Empty);
+            }
         }
 
         void ReleasePages()
@@ -80,8 +222,14 @@ namespace ZwcReaderWCE
             {
                 if (key < currentPageIndex - 1 || key > currentPageIndex + 1)
                 {
-                    cachePages[key].Dispose();
+                    Bitmap page = cachePages[key];
                     cachePages.Remove(key);
+
+                    // Pages sharing stored bytes share the bitmap.
+                    if (!cachePages.ContainsValue(page))
+                    {
+                        page.Dispose();
+                    }
                 }
             }
         }
@@ -93,7 +241,18 @@ namespace ZwcReaderWCE
                 return cachePages[index];
             }
 
-            var page = LoadPageFromFile(index);
+            int storedPage = GetStoredPage(index);
+            foreach (var cachePage in cachePages)
+            {
+                if (GetStoredPage(cachePage.Key) == storedPage)
+                {
+                    cachePages[index] = cachePage.Value;
+                    return cachePage.Value;
+                }
+            }
+
+            bool isBase;
+            var page = LoadPageFromFile(index, false, out isBase);
             if (page != null)
             {
                 cachePages[index] = page;
@@ -102,8 +261,22 @@ namespace ZwcReaderWCE
             return page;
         }
 
-        Bitmap LoadPageFromFile(int index)
+        /// <summary>
+        /// Decode a page without the cache, for timing.
+        /// </summary>
+        public Bitmap LoadPage(int index, bool baseOnly)
         {
+            lock (cacheLock)
+            {
+                bool isBase;
+                return LoadPageFromFile(index, baseOnly, out isBase);
+            }
+        }
+
+        Bitmap LoadPageFromFile(int index, bool baseOnly, out bool isBase)
+        {
+            isBase = false;
+
             // Load page from book package.
             if (bookPackage != null)
             {
@@ -112,7 +285,7 @@ namespace ZwcReaderWCE
                     return null;
                 }
 
-                bookPackage.Seek(index * 4, SeekOrigin.Begin);
+                bookPackage.Seek(GetStoredPage(index) * 4, SeekOrigin.Begin);
                 int pageOffset = ReadInt(bookPackage);
                 int nextPageOffset = ReadInt(bookPackage);
                 int pageSize = nextPageOffset - pageOffset;
@@ -121,7 +294,18 @@ namespace ZwcReaderWCE
                 byte[] bookContent = new byte[pageSize];
                 bookPackage.Read(bookContent, 0, pageSize);
 
-                return new Bitmap(new MemoryStream(bookContent));
+                if (ProgressivePage.IsProgressivePage(bookContent))
+                {
+                    if (baseOnly)
+                    {
+                        isBase = true;
+                        return ProgressivePage.RenderBase(bookContent);
+                    }
+
+                    bookContent = ProgressivePage.GetFullPage(bookContent);
+                }
+
+                return DecodePage(bookContent);
             }
 
             // Load from gif file.
@@ -130,13 +314,51 @@ namespace ZwcReaderWCE
             {
                 using (FileStream fileStream = File.Open(filePath, FileMode.Open, FileAccess.Read))
                 {
-                    return new Bitmap(fileStream);
+                    byte[] content = new byte[fileStream.Length];
+                    fileStream.Read(content, 0, content.Length);
+                    return DecodePage(content);
+                }
+            }
+
+            // Load from glyph run file.
+            filePath = Path.Combine(pageFolder, string.Format("{0:D4}.zrf", index));
+            if (File.Exists(filePath))
+            {
+                using (FileStream fileStream = File.Open(filePath, FileMode.Open, FileAccess.Read))
+                {
+                    byte[] content = new byte[fileStream.Length];
+                    fileStream.Read(content, 0, content.Length);
+                    return GlyphRunPage.Render(content);
                 }
             }
 
             return null;
         }
 
+        Bitmap DecodePage(byte[] bookContent)
+        {
+            if (GlyphRunPage.IsGlyphRunPage(bookContent))
+            {
+                return GlyphRunPage.Render(bookContent);
+            }
+
+            if (SymbolPage.IsSymbolPage(bookContent))
+            {
+                return symbolPage.Render(bookContent);
+            }
+
+            if (UseGifDecoder)
+            {
+                Bitmap page = gifDecoder.Decode(bookContent);
+                if (page != null)
+                {
+                    return page;
+                }
+            }
+
+            return new Bitmap(new MemoryStream(bookContent));
+        }
+
         int ReadInt(Stream stream)
         {
             byte[] bytes = new byte[4];
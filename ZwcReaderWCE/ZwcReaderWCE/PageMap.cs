@@ -0,0 +1,229 @@
+﻿using System;
+
+using System.Collections.Generic;
+using System.Text;
+using System.IO;
+
+namespace ZwcReaderWCE
+{
+    /// <summary>
+    /// Source page to book page mapping from the PMAP section written by
+    /// BookMaker. Source pages are stacked as parts, each a column or band of a
+    /// page at its own zoom, and the stack is cut into book pages. A position
+    /// is mapped through the part holding it, book pages are found by binary
+    /// search on where they start.
+    /// </summary>
+    public class PageMap
+    {
+        public const string SectionTag = "PMAP";
+
+        /// <summary>
+        /// The part Left, Top to Right, Bottom of source page SourcePage (counted
+        /// from 0) shown on a book page, in pixels of the page rendered 800 wide.
+        /// </summary>
+        public struct SourceSpan
+        {
+            public int SourcePage;
+            public int Left;
+            public int Top;
+            public int Right;
+            public int Bottom;
+        }
+
+        // A part of a source page, Scale is its zoom in 1/65536.
+        struct Segment
+        {
+            public int SourcePage;
+            public int Left;
+            public int Top;
+            public int Right;
+            public int Bottom;
+            public int Scale;
+        }
+
+        Segment[] segments = new Segment[0];
+        // Top of each part on the stack, then the end of the last one.
+        int[] segmentBounds = new int[0];
+        // First part of each source page, then the part count.
+        int[] sourceFirstSegments = new int[0];
+        int[] outputBounds = new int[0];
+
+        public PageMap(PackageSections sections)
+        {
+            int offset, length;
+            if (!sections.Find(SectionTag, out offset, out length))
+            {
+                return;
+            }
+
+            using (FileStream package = sections.Open())
+            {
+                package.Seek(offset, SeekOrigin.Begin);
+                ReadSegments(package);
+                outputBounds = ReadBounds(package);
+            }
+        }
+
+        public bool IsAvailable
+        {
+            get
+            {
+                return segments.Length > 0 && outputBounds.Length > 1;
+            }
+        }
+
+        /// <summary>
+        /// Book page showing pixel (x, y) of a source page, 0 if unknown.
+        /// </summary>
+        public int GetOutputPage(int sourcePage, int x, int y)
+        {
+            if (!IsAvailable || sourcePage < 0 || sourcePage >= sourceFirstSegments.Length - 1)
+            {
+                return 0;
+            }
+
+            int index = FindSegment(sourcePage, x, y);
+            if (index < 0)
+            {
+                return 0;
+            }
+
+            Segment segment = segments[index];
+            int bookY = segmentBounds[index] + (int)((long)(y - segment.Top) * segment.Scale >> 16);
+            bookY = Math.Min(Math.Max(bookY, segmentBounds[index]), segmentBounds[index + 1]);
+            return FindLast(outputBounds, bookY) + 1;
+        }
+
+        public List<SourceSpan> GetSourceSpans(int outputPage)
+        {
+            List<SourceSpan> spans = new List<SourceSpan>();
+            if (!IsAvailable || outputPage < 1 || outputPage >= outputBounds.Length)
+            {
+                return spans;
+            }
+
+            int pageTop = outputBounds[outputPage - 1];
+            int pageBottom = outputBounds[outputPage];
+            for (int index = FindLast(segmentBounds, pageTop); index < segments.Length; ++index)
+            {
+                int segmentTop = segmentBounds[index];
+                int segmentBottom = segmentBounds[index + 1];
+                if (segmentTop >= pageBottom)
+                {
+                    break;
+                }
+
+                int top = Math.Max(pageTop, segmentTop) - segmentTop;
+                int bottom = Math.Min(pageBottom, segmentBottom) - segmentTop;
+                if (bottom <= top)
+                {
+                    continue;
+                }
+
+                // Rows on the stack back to rows of the source page at the zoom of the part.
+                Segment segment = segments[index];
+                SourceSpan span = new SourceSpan();
+                span.SourcePage = segment.SourcePage;
+                span.Left = segment.Left;
+                span.Right = segment.Right;
+                span.Top = segment.Top + (int)(((long)top << 16) / segment.Scale);
+                span.Bottom = Math.Min(segment.Bottom, segment.Top + (int)((((long)bottom << 16) + segment.Scale - 1) / segment.Scale));
+                if (span.Bottom > span.Top)
+                {
+                    spans.Add(span);
+                }
+            }
+
+            return spans;
+        }
+
+        /// <summary>
+        /// The part of a source page holding a pixel. Outside of all parts, the
+        /// first part level with it or else the last part above it, as BookMaker
+        /// places text. -1 if the page has no parts.
+        /// </summary>
+        int FindSegment(int sourcePage, int x, int y)
+        {
+            int first = sourceFirstSegments[sourcePage];
+            int end = sourceFirstSegments[sourcePage + 1];
+            int found = -1;
+            for (int index = first; index < end; ++index)
+            {
+                Segment segment = segments[index];
+                if (y >= segment.Top && y < segment.Bottom && x >= segment.Left && x < segment.Right)
+                {
+                    return index;
+                }
+                if (y >= segment.Top && (found < 0 || y >= segments[found].Bottom))
+                {
+                    found = index;
+                }
+            }
+
+            if (found < 0 && first < end)
+            {
+                found = first;
+            }
+            return found;
+        }
+
+        /// <summary>
+        /// Last entry starting at or before value, the end entry excluded.
+        /// </summary>
+        static int FindLast(int[] bounds, int value)
+        {
+            int index = Array.BinarySearch(bounds, 0, bounds.Length - 1, value);
+            if (index < 0)
+            {
+                index = ~index - 1;
+            }
+            return Math.Max(index, 0);
+        }
+
+        void ReadSegments(Stream stream)
+        {
+            int count = PackageSections.ReadInt(stream);
+            Segment[] read = new Segment[count];
+            int[] bounds = new int[count + 1];
+            for (int i = 0; i < count; ++i)
+            {
+                read[i].SourcePage = PackageSections.ReadInt(stream);
+                read[i].Left = PackageSections.ReadInt(stream);
+                read[i].Top = PackageSections.ReadInt(stream);
+                read[i].Right = PackageSections.ReadInt(stream);
+                read[i].Bottom = PackageSections.ReadInt(stream);
+                read[i].Scale = Math.Max(PackageSections.ReadInt(stream), 1);
+                bounds[i] = PackageSections.ReadInt(stream);
+            }
+            bounds[count] = PackageSections.ReadInt(stream);
+
+            // Parts of a source page are written together, in page order.
+            int sourcePageCount = count > 0 ? read[count - 1].SourcePage + 1 : 0;
+            int[] firstSegments = new int[sourcePageCount + 1];
+            int segment = 0;
+            for (int sourcePage = 0; sourcePage <= sourcePageCount; ++sourcePage)
+            {
+                while (segment < count && read[segment].SourcePage < sourcePage)
+                {
+                    ++segment;
+                }
+                firstSegments[sourcePage] = segment;
+            }
+
+            segments = read;
+            segmentBounds = bounds;
+            sourceFirstSegments = firstSegments;
+        }
+
+        static int[] ReadBounds(Stream stream)
+        {
+            int count = PackageSections.ReadInt(stream);
+            int[] bounds = new int[count + 1];
+            for (int i = 0; i <= count; ++i)
+            {
+                bounds[i] = PackageSections.ReadInt(stream);
+            }
+            return bounds;
+        }
+    }
+}
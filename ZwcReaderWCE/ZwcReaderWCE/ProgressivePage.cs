@@ -0,0 +1,126 @@
+﻿using System;
+
+using System.Collections.Generic;
+using System.Text;
+using System.Drawing;
+using System.Drawing.Imaging;
+using System.Runtime.InteropServices;
+
+namespace ZwcReaderWCE
+{
+    /// <summary>
+    /// Page written by BookMaker in two layers: a coarse 1 bit base layer that
+    /// is drawn while the user flips fast, then the full page in any of the
+    /// other page encodings. See ProgressivePage there for the layout.
+    /// </summary>
+    public static class ProgressivePage
+    {
+        const int pageWidth = 600;
+        const int pageHeight = 800;
+        const int baseScale = 4;
+        const int baseWidth = pageWidth / baseScale;
+        const int baseHeight = pageHeight / baseScale;
+
+        // Base layer ink is drawn dark gray, it is only a preview, as RGB 565.
+        const short inkColor = 0x2104;
+        const short paperColor = -1;
+
+        static readonly byte[] pageMagic = Encoding.ASCII.GetBytes("ZPG1");
+
+        public static bool IsProgressivePage(byte[] content)
+        {
+            if (content.Length < pageMagic.Length)
+            {
+                return false;
+            }
+
+            for (int i = 0; i < pageMagic.Length; ++i)
+            {
+                if (content[i] != pageMagic[i])
+                {
+                    return false;
+                }
+            }
+
+            return true;
+        }
+
+        /// <summary>
+        /// The full page after the base layer, to be decoded as any other page.
+        /// </summary>
+        public static byte[] GetFullPage(byte[] content)
+        {
+            int start = pageMagic.Length + 4 + BitConverter.ToInt32(content, pageMagic.Length);
+            byte[] fullPage = new byte[content.Length - start];
+            Array.Copy(content, start, fullPage, 0, fullPage.Length);
+            return fullPage;
+        }
+
+        /// <summary>
+        /// Draw only the base layer, each bit as a block of baseScale pixels square.
+        /// </summary>
+        public static Bitmap RenderBase(byte[] content)
+        {
+            int rowBytes = (baseWidth + 7) / 8;
+            byte[] bits = UnpackBits(content, pageMagic.Length + 4, BitConverter.ToInt32(content, pageMagic.Length), rowBytes * baseHeight);
+
+            Bitmap page = new Bitmap(pageWidth, pageHeight, PixelFormat.Format16bppRgb565);
+            BitmapData data = page.LockBits(new Rectangle(0, 0, pageWidth, pageHeight), ImageLockMode.WriteOnly, PixelFormat.Format16bppRgb565);
+            try
+            {
+                short[] row = new short[pageWidth];
+                for (int blockY = 0; blockY < baseHeight; ++blockY)
+                {
+                    int bitRow = blockY * rowBytes;
+                    for (int blockX = 0; blockX < baseWidth; ++blockX)
+                    {
+                        bool ink = (bits[bitRow + blockX / 8] & (0x80 >> (blockX & 7))) != 0;
+                        short color = ink ? inkColor : paperColor;
+                        for (int x = blockX * baseScale; x < (blockX + 1) * baseScale; ++x)
+                        {
+                            row[x] = color;
+                        }
+                    }
+
+                    for (int y = blockY * baseScale; y < (blockY + 1) * baseScale; ++y)
+                    {
+                        Marshal.Copy(row, 0, new IntPtr(data.Scan0.ToInt32() + y * data.Stride), pageWidth);
+                    }
+                }
+            }
+            finally
+            {
+                page.UnlockBits(data);
+            }
+
+            return page;
+        }
+
+        static byte[] UnpackBits(byte[] content, int offset, int length, int size)
+        {
+            byte[] data = new byte[size];
+            int end = offset + length;
+            int position = 0;
+            while (offset < end && position < size)
+            {
+                int header = content[offset++];
+                if (header < 128)
+                {
+                    int count = Math.Min(header + 1, size - position);
+                    Array.Copy(content, offset, data, position, count);
+                    offset += header + 1;
+                    position += count;
+                }
+                else if (header > 128)
+                {
+                    byte value = content[offset++];
+                    for (int i = 0; i < 257 - header && position < size; ++i)
+                    {
+                        data[position++] = value;
+                    }
+                }
+            }
+            return data;
+        }
+    }
+}
\ No newline at end of file
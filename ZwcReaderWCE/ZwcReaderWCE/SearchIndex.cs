@@ -0,0 +1,306 @@
+﻿using System;
+
+using System.Collections.Generic;
+using System.Text;
+using System.IO;
+
+namespace ZwcReaderWCE
+{
+    /// <summary>
+    /// Full text search over the SRCH section written by BookMaker. The term table
+    /// is binary searched in place in the package file, only the entries and
+    /// postings a query touches are read.
+    /// </summary>
+    public class SearchIndex : IDisposable
+    {
+        public const string SectionTag = "SRCH";
+        const int maxWordLength = 32;
+
+        FileStream package;
+        int termCount;
+        int entriesOffset;
+        int termsOffset;
+        int postingsOffset;
+
+        public SearchIndex(PackageSections sections)
+        {
+            int offset, length;
+            if (!sections.Find(SectionTag, out offset, out length))
+            {
+                return;
+            }
+
+            package = sections.Open();
+            package.Seek(offset, SeekOrigin.Begin);
+            termCount = PackageSections.ReadInt(package);
+            entriesOffset = offset + 4;
+            termsOffset = entriesOffset + (termCount + 1) * 8;
+
+            int termCharCount = ReadEntry(termCount)[0];
+            postingsOffset = termsOffset + termCharCount * 2;
+        }
+
+        public void Dispose()
+        {
+            if (package != null)
+            {
+                package.Close();
+                package = null;
+            }
+        }
+
+        public bool IsAvailable
+        {
+            get
+            {
+                return package != null;
+            }
+        }
+
+        /// <summary>
+        /// Output pages containing every term of the query, in page order. CJK
+        /// words match when all their bigrams are on the same page.
+        /// </summary>
+        public int[] Search(string query)
+        {
+            if (package == null)
+            {
+                return new int[0];
+            }
+
+            List<string> terms = new List<string>();
+            Tokenize(query, terms);
+
+            List<int> result = null;
+            foreach (string term in terms)
+            {
+                List<int> pages = FindPages(term);
+                result = result == null ? pages : Intersect(result, pages);
+                if (result.Count == 0)
+                {
+                    break;
+                }
+            }
+
+            return result == null ? new int[0] : result.ToArray();
+        }
+
+        List<int> FindPages(string term)
+        {
+            // First entry not less than the term.
+            int low = 0;
+            int high = termCount;
+            while (low < high)
+            {
+                int middle = (low + high) / 2;
+                if (string.CompareOrdinal(ReadTerm(middle), term) < 0)
+                {
+                    low = middle + 1;
+                }
+                else
+                {
+                    high = middle;
+                }
+            }
+
+            // Single CJK characters are indexed on their own. Packages built
+            // before that only have them in bigrams, those starting with it
+            // are found next to it in the term table.
+            bool isPrefix = term.Length == 1 && IsCjk(term[0]);
+
+            List<int> pages = new List<int>();
+            for (int index = low; index < termCount; ++index)
+            {
+                string entryTerm = ReadTerm(index);
+                if (entryTerm == term)
+                {
+                    pages = Union(pages, ReadPostings(index));
+                }
+                else if (isPrefix && entryTerm[0] == term[0])
+                {
+                    pages = Union(pages, ReadPostings(index));
+                }
+                else
+                {
+                    break;
+                }
+            }
+
+            return pages;
+        }
+
+        int[] ReadEntry(int index)
+        {
+            package.Seek(entriesOffset + index * 8, SeekOrigin.Begin);
+            byte[] bytes = new byte[16];
+            package.Read(bytes, 0, bytes.Length);
+            return new int[]
+            {
+                BitConverter.ToInt32(bytes, 0),
+                BitConverter.ToInt32(bytes, 4),
+                BitConverter.ToInt32(bytes, 8),
+                BitConverter.ToInt32(bytes, 12)
+            };
+        }
+
+        string ReadTerm(int index)
+        {
+            int[] entry = ReadEntry(index);
+            int length = entry[2] - entry[0];
+
+            package.Seek(termsOffset + entry[0] * 2, SeekOrigin.Begin);
+            byte[] bytes = new byte[length * 2];
+            package.Read(bytes, 0, bytes.Length);
+            return Encoding.Unicode.GetString(bytes, 0, bytes.Length);
+        }
+
+        List<int> ReadPostings(int index)
+        {
+            int[] entry = ReadEntry(index);
+            int length = entry[3] - entry[1];
+
+            package.Seek(postingsOffset + entry[1], SeekOrigin.Begin);
+            byte[] bytes = new byte[length];
+            package.Read(bytes, 0, bytes.Length);
+
+            List<int> pages = new List<int>();
+            int page = 0;
+            int position = 0;
+            while (position < bytes.Length)
+            {
+                int delta = 0;
+                int shift = 0;
+                byte b;
+                do
+                {
+                    b = bytes[position++];
+                    delta |= (b & 0x7F) << shift;
+                    shift += 7;
+                }
+                while ((b & 0x80) != 0);
+
+                page += delta;
+                pages.Add(page);
+            }
+
+            return pages;
+        }
+
+        static List<int> Intersect(List<int> first, List<int> second)
+        {
+            List<int> result = new List<int>();
+            int i = 0;
+            int j = 0;
+            while (i < first.Count && j < second.Count)
+            {
+                if (first[i] < second[j])
+                {
+                    ++i;
+                }
+                else if (first[i] > second[j])
+                {
+                    ++j;
+                }
+                else
+                {
+                    result.Add(first[i]);
+                    ++i;
+                    ++j;
+                }
+            }
+            return result;
+        }
+
+        static List<int> Union(List<int> first, List<int> second)
+        {
+            List<int> result = new List<int>();
+            int i = 0;
+            int j = 0;
+            while (i < first.Count || j < second.Count)
+            {
+                if (j >= second.Count || (i < first.Count && first[i] < second[j]))
+                {
+                    result.Add(first[i++]);
+                }
+                else if (i >= first.Count || second[j] < first[i])
+                {
+                    result.Add(second[j++]);
+                }
+                else
+                {
+                    result.Add(first[i]);
+                    ++i;
+                    ++j;
+                }
+            }
+            return result;
+        }
+
+        /// <summary>
+        /// Same splitting as SearchIndexBuilder.Tokenize in BookMaker, except that
+        /// a run of several CJK characters gives only its bigrams.
+        /// </summary>
+        static void Tokenize(string text, List<string> terms)
+        {
+            int index = 0;
+            while (index < text.Length)
+            {
+                char c = Normalize(text[index]);
+                if (IsCjk(c))
+                {
+                    StringBuilder run = new StringBuilder();
+                    for (; index < text.Length && IsCjk(Normalize(text[index])); ++index)
+                    {
+                        run.Append(text[index]);
+                    }
+
+                    if (run.Length == 1)
+                    {
+                        terms.Add(run.ToString());
+                    }
+                    for (int i = 0; i + 1 < run.Length; ++i)
+                    {
+                        terms.Add(run.ToString(i, 2));
+                    }
+                }
+                else if (char.IsLetterOrDigit(c))
+                {
+                    StringBuilder word = new StringBuilder();
+                    for (; index < text.Length; ++index)
+                    {
+                        char current = Normalize(text[index]);
+                        if (!char.IsLetterOrDigit(current) || IsCjk(current))
+                        {
+                            break;
+                        }
+                        if (word.Length < maxWordLength)
+                        {
+                            word.Append(current);
+                        }
+                    }
+
+                    terms.Add(word.ToString());
+                }
+                else
+                {
+                    ++index;
+                }
+            }
+        }
+
+        static char Normalize(char c)
+        {
+            // Full width ASCII to ASCII.
+            if (c >= '！' && c <= '～')
+            {
+                c = (char)(c - 0xFEE0);
+            }
+            return char.ToLower(c);
+        }
+
+        static bool IsCjk(char c)
+        {
+            return c >= '⺀' && char.IsLetterOrDigit(c);
+        }
+    }
+}
@@ -0,0 +1,188 @@
+﻿using System;
+
+using System.Collections.Generic;
+using System.Text;
+using System.Drawing;
+using System.Drawing.Imaging;
+using System.IO;
+using System.Runtime.InteropServices;
+
+namespace ZwcReaderWCE
+{
+    /// <summary>
+    /// Page written by BookMaker as symbols of the book dictionary in the SYMB
+    /// section plus a residual of raw gray levels, see SymbolCodec there.
+    /// </summary>
+    public class SymbolPage
+    {
+        public const string SectionTag = "SYMB";
+
+        const int pageWidth = 600;
+        const int pageHeight = 800;
+        const byte white = 15;
+
+        static readonly byte[] pageMagic = Encoding.ASCII.GetBytes("ZSY1");
+
+        // The whole section, symbols are read where they are.
+        byte[] symbolData = new byte[0];
+        int[] symbolOffsets = new int[0];
+
+        // Reused from page to page.
+        byte[] levels = new byte[pageWidth * pageHeight];
+        short[] row = new short[pageWidth];
+        short[] colors = new short[16];
+
+        public SymbolPage(PackageSections sections)
+        {
+            int offset, length;
+            if (!sections.Find(SectionTag, out offset, out length))
+            {
+                return;
+            }
+
+            using (FileStream package = sections.Open())
+            {
+                package.Seek(offset, SeekOrigin.Begin);
+                symbolData = new byte[length];
+                package.Read(symbolData, 0, length);
+            }
+
+            int count = BitConverter.ToInt32(symbolData, 0);
+            symbolOffsets = new int[count];
+            int position = 4;
+            for (int i = 0; i < count; ++i)
+            {
+                symbolOffsets[i] = position;
+                position += 2 + (symbolData[position] * symbolData[position + 1] + 1) / 2;
+            }
+
+            // The 16 levels as RGB 565.
+            for (int level = 0; level < colors.Length; ++level)
+            {
+                int value = level * 17;
+                colors[level] = (short)(((value >> 3) << 11) | ((value >> 2) << 5) | (value >> 3));
+            }
+        }
+
+        public static bool IsSymbolPage(byte[] content)
+        {
+            if (content.Length < pageMagic.Length)
+            {
+                return false;
+            }
+
+            for (int i = 0; i < pageMagic.Length; ++i)
+            {
+                if (content[i] != pageMagic[i])
+                {
+                    return false;
+                }
+            }
+
+            return true;
+        }
+
+        public Bitmap Render(byte[] content)
+        {
+            for (int i = 0; i < levels.Length; ++i)
+            {
+                levels[i] = white;
+            }
+
+            int offset = pageMagic.Length;
+            int count = ReadVarint(content, ref offset);
+            int x = 0;
+            int y = 0;
+            for (int i = 0; i < count; ++i)
+            {
+                y += ReadVarint(content, ref offset);
+                int dx = ReadVarint(content, ref offset);
+                x += (dx >> 1) ^ -(dx & 1);
+                DrawSymbol(ReadVarint(content, ref offset), x, y);
+            }
+
+            count = ReadVarint(content, ref offset);
+            int position = 0;
+            for (int i = 0; i < count; ++i)
+            {
+                position += ReadVarint(content, ref offset);
+                int length = ReadVarint(content, ref offset);
+                for (int pixel = 0; pixel < length; pixel += 2)
+                {
+                    byte packed = content[offset++];
+                    levels[position++] = (byte)(packed >> 4);
+                    if (pixel + 1 < length)
+                    {
+                        levels[position++] = (byte)(packed & 0xF);
+                    }
+                }
+            }
+
+            return ToBitmap();
+        }
+
+        /// <summary>
+        /// Symbols only add ink, overlapping boxes keep the darker level.
+        /// </summary>
+        void DrawSymbol(int index, int x, int y)
+        {
+            int offset = symbolOffsets[index];
+            int width = symbolData[offset];
+            int height = symbolData[offset + 1];
+            offset += 2;
+
+            int pixel = 0;
+            for (int symbolY = 0; symbolY < height; ++symbolY)
+            {
+                int target = (y + symbolY) * pageWidth + x;
+                for (int symbolX = 0; symbolX < width; ++symbolX, ++pixel, ++target)
+                {
+                    byte packed = symbolData[offset + (pixel >> 1)];
+                    byte level = (byte)((pixel & 1) == 0 ? packed >> 4 : packed & 0xF);
+                    if (level < levels[target])
+                    {
+                        levels[target] = level;
+                    }
+                }
+            }
+        }
+
+        Bitmap ToBitmap()
+        {
+            Bitmap page = new Bitmap(pageWidth, pageHeight, PixelFormat.Format16bppRgb565);
+            BitmapData data = page.LockBits(new Rectangle(0, 0, pageWidth, pageHeight), ImageLockMode.WriteOnly, PixelFormat.Format16bppRgb565);
+            try
+            {
+                for (int y = 0; y < pageHeight; ++y)
+                {
+                    int source = y * pageWidth;
+                    for (int x = 0; x < pageWidth; ++x)
+                    {
+                        row[x] = colors[levels[source + x]];
+                    }
+                    Marshal.Copy(row, 0, new IntPtr(data.Scan0.ToInt32() + y * data.Stride), pageWidth);
+                }
+            }
+            finally
+            {
+                page.UnlockBits(data);
+            }
+
+            return page;
+        }
+
+        static int ReadVarint(byte[] content, ref int offset)
+        {
+            int value = 0;
+            for (int shift = 0; ; shift += 7)
+            {
+                byte part = content[offset++];
+                value |= (part & 0x7F) << shift;
+                if (part < 0x80)
+                {
+                    return value;
+                }
+            }
+        }
+    }
+}
\ No newline at end of file
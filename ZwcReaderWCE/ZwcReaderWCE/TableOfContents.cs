@@ -0,0 +1,79 @@
+﻿using System;
+
+using System.Collections.Generic;
+using System.Text;
+using System.IO;
+
+namespace ZwcReaderWCE
+{
+    /// <summary>
+    /// Chapters from the "TOC " section written by BookMaker.
+    /// </summary>
+    public class TableOfContents
+    {
+        public const string SectionTag = "TOC ";
+
+        public class Entry
+        {
+            public int Level;
+            public string Title;
+            public int Page;
+        }
+
+        List<Entry> entries = new List<Entry>();
+
+        public TableOfContents(PackageSections sections)
+        {
+            int offset, length;
+            if (!sections.Find(SectionTag, out offset, out length))
+            {
+                return;
+            }
+
+            byte[] section = new byte[length];
+            using (FileStream package = sections.Open())
+            {
+                package.Seek(offset, SeekOrigin.Begin);
+                package.Read(section, 0, length);
+            }
+
+            int count = BitConverter.ToInt32(section, 0);
+            int position = 4;
+            for (int i = 0; i < count; ++i)
+            {
+                Entry entry = new Entry();
+                entry.Level = BitConverter.ToUInt16(section, position);
+                entry.Page = BitConverter.ToInt32(section, position + 2);
+                int titleLength = BitConverter.ToUInt16(section, position + 6);
+                entry.Title = Encoding.Unicode.GetString(section, position + 8, titleLength * 2);
+                position += 8 + titleLength * 2;
+
+                entries.Add(entry);
+            }
+        }
+
+        public List<Entry> Entries
+        {
+            get
+            {
+                return entries;
+            }
+        }
+
+        /// <summary>
+        /// Index of the chapter a page belongs to, -1 before the first one.
+        /// </summary>
+        public int FindEntry(int page)
+        {
+            int result = -1;
+            for (int i = 0; i < entries.Count; ++i)
+            {
+                if (entries[i].Page <= page)
+                {
+                    result = i;
+                }
+            }
+            return result;
+        }
+    }
+}
@@ -0,0 +1,139 @@
+﻿using System;
+
+using System.Collections.Generic;
+using System.Text;
+using System.Drawing;
+using System.IO;
+
+namespace ZwcReaderWCE
+{
+    /// <summary>
+    /// Character boxes of each page from the TEXT section written by BookMaker,
+    /// in pixels of the page as it is drawn. Only the layer of the page being
+    /// tested is read, the last one is kept for the next test.
+    /// </summary>
+    public class TextLayer : IDisposable
+    {
+        public const string SectionTag = "TEXT";
+
+        FileStream package;
+        int sectionOffset;
+        int pageCount;
+
+        int layerPage = 0;
+        char[] unicodes = new char[0];
+        int[] lefts = new int[0];
+        int[] tops = new int[0];
+        int[] widths = new int[0];
+        int[] heights = new int[0];
+
+        public TextLayer(PackageSections sections)
+        {
+            int length;
+            if (!sections.Find(SectionTag, out sectionOffset, out length))
+            {
+                return;
+            }
+
+            package = sections.Open();
+            package.Seek(sectionOffset, SeekOrigin.Begin);
+            pageCount = PackageSections.ReadInt(package);
+        }
+
+        public void Dispose()
+        {
+            if (package != null)
+            {
+                package.Close();
+                package = null;
+            }
+        }
+
+        public bool IsAvailable
+        {
+            get
+            {
+                return package != null;
+            }
+        }
+
+        /// <summary>
+        /// The character at a point of a page, '\0' if there is none.
+        /// </summary>
+        public char HitTest(int page, int x, int y, out Rectangle box)
+        {
+            box = Rectangle.Empty;
+            if (package == null || page < 1 || page > pageCount)
+            {
+                return '\0';
+            }
+
+            if (page != layerPage)
+            {
+                LoadLayer(page);
+            }
+
+            for (int index = 0; index < unicodes.Length; ++index)
+            {
+                if (x >= lefts[index] && x < lefts[index] + widths[index]
+                    && y >= tops[index] && y < tops[index] + heights[index])
+                {
+                    box = new Rectangle(lefts[index], tops[index], widths[index], heights[index]);
+                    return unicodes[index];
+                }
+            }
+
+            return '\0';
+        }
+
+        void LoadLayer(int page)
+        {
+            package.Seek(sectionOffset + 4 + (page - 1) * 4, SeekOrigin.Begin);
+            int offset = PackageSections.ReadInt(package);
+            int nextOffset = PackageSections.ReadInt(package);
+
+            byte[] layer = new byte[nextOffset - offset];
+            package.Seek(sectionOffset + offset, SeekOrigin.Begin);
+            package.Read(layer, 0, layer.Length);
+
+            int count = BitConverter.ToUInt16(layer, 0);
+            unicodes = new char[count];
+            lefts = new int[count];
+            tops = new int[count];
+            widths = new int[count];
+            heights = new int[count];
+
+            int position = 2;
+            for (int index = 0; index < count; ++index, position += 2)
+            {
+                unicodes[index] = (char)BitConverter.ToUInt16(layer, position);
+            }
+
+            int previous = 0;
+            for (int index = 0; index < count; ++index, position += 2)
+            {
+                previous += BitConverter.ToInt16(layer, position);
+                lefts[index] = previous;
+            }
+
+            previous = 0;
+            for (int index = 0; index < count; ++index, position += 2)
+            {
+                previous += BitConverter.ToInt16(layer, position);
+                tops[index] = previous;
+            }
+
+            for (int index = 0; index < count; ++index, position += 2)
+            {
+                widths[index] = BitConverter.ToUInt16(layer, position);
+            }
+
+            for (int index = 0; index < count; ++index, position += 2)
+            {
+                heights[index] = BitConverter.ToUInt16(layer, position);
+            }
+
+            layerPage = page;
+        }
+    }
+}